@@ -1,221 +1,379 @@
-﻿#include <windows.h>
-#include <iostream>
-#include <string>
-#include "employee.h"
-using namespace std;
-
-bool sendRequest(const Request& req, Response& resp) {
-    try {
-        string responsePipeName = "\\\\.\\pipe\\client_pipe_" + to_string(req.clientPid);
-
-        HANDLE hResponsePipe = CreateNamedPipeA(
-            responsePipeName.c_str(),
-            PIPE_ACCESS_INBOUND,
-            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
-            1,
-            sizeof(Response),
-            sizeof(Response),
-            0,
-            NULL);
-
-        if (hResponsePipe == INVALID_HANDLE_VALUE) {
-            cout << "Ошибка создания клиентского канала\n";
-            return false;
-        }
-
-        HANDLE hServerPipe = CreateFileA(
-            "\\\\.\\pipe\\server_pipe",
-            GENERIC_WRITE,
-            0,
-            NULL,
-            OPEN_EXISTING,
-            0,
-            NULL);
-
-        if (hServerPipe == INVALID_HANDLE_VALUE) {
-            cout << "Сервер не запущен!\n";
-            CloseHandle(hResponsePipe);
-            return false;
-        }
-
-        DWORD written;
-        if (!WriteFile(hServerPipe, &req, sizeof(req), &written, NULL)) {
-            cout << "Ошибка отправки запроса\n";
-            CloseHandle(hServerPipe);
-            CloseHandle(hResponsePipe);
-            return false;
-        }
-        CloseHandle(hServerPipe);
-
-        ConnectNamedPipe(hResponsePipe, NULL);
-
-        DWORD bytesRead;
-        if (!ReadFile(hResponsePipe, &resp, sizeof(resp), &bytesRead, NULL)) {
-            cout << "Ошибка чтения ответа\n";
-            CloseHandle(hResponsePipe);
-            return false;
-        }
-
-        CloseHandle(hResponsePipe);
-        return true;
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при отправке запроса: " << e.what() << endl;
-        return false;
-    }
-}
-
-void printRecord(const employee& e) {
-    try {
-        cout << "\n=== Запись сотрудника ===\n";
-        cout << "ID: " << e.num << endl;
-        cout << "Имя: " << e.name << endl;
-        cout << "Часы: " << e.hours << endl;
-        cout << "==========================\n";
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при выводе записи: " << e.what() << endl;
-    }
-}
-
-int main() {
-    try {
-        setlocale(LC_ALL, "rus");
-        cout << " Клиент \n";
-        cout << "PID процесса: " << GetCurrentProcessId() << "\n\n";
-
-        DWORD pid = GetCurrentProcessId();
-
-        while (true) {
-            try {
-                cout << "\nМеню:\n";
-                cout << "1 - Чтение записи\n";
-                cout << "2 - Модификация записи\n";
-                cout << "3 - Выход\n";
-                cout << "Выберите действие: ";
-
-                int choice;
-                cin >> choice;
-
-                if (choice == 3) {
-                    Request req{};
-                    req.cmd = CMD_EXIT;
-                    req.clientPid = pid;
-                    Response resp;
-                    sendRequest(req, resp);
-                    break;
-                }
-
-                if (choice != 1 && choice != 2) {
-                    cout << "Неверный выбор! Пожалуйста, выберите 1, 2 или 3.\n";
-                    continue;
-                }
-
-                cout << "Введите ID сотрудника: ";
-                int id;
-                cin >> id;
-
-                if (choice == 1) {
-                    Request req{};
-                    req.cmd = CMD_READ;
-                    req.id = id;
-                    req.clientPid = pid;
-
-                    Response resp;
-                    cout << "Пытаюсь прочитать запись " << id << "...\n";
-
-                    if (!sendRequest(req, resp)) {
-                        cout << "Ошибка соединения\n";
-                        continue;
-                    }
-
-                    if (!resp.ok) {
-                        if (resp.data.num == 0) {
-                            cout << "Запись не найдена!\n";
-                        }
-                        else {
-                            cout << "Запись занята писателем! Попробуйте позже.\n";
-                        }
-                        continue;
-                    }
-
-                    printRecord(resp.data);
-
-                    cout << "Нажмите Enter для завершения чтения...";
-                    cin.ignore();
-                    cin.get();
-
-                    req.cmd = CMD_FINISH_ACCESS;
-                    sendRequest(req, resp);
-                }
-                else if (choice == 2) {
-                    Request req{};
-                    req.cmd = CMD_WRITE_REQUEST;
-                    req.id = id;
-                    req.clientPid = pid;
-
-                    Response resp;
-                    cout << "Пытаюсь получить доступ для записи " << id << "...\n";
-
-                    if (!sendRequest(req, resp)) {
-                        cout << "Ошибка соединения\n";
-                        continue;
-                    }
-
-                    if (!resp.ok) {
-                        cout << "Запись занята.\n";
-                        continue;
-                    }
-
-                    cout << "\nТекущие данные:\n";
-                    printRecord(resp.data);
-
-                    employee modified = resp.data;
-                    cout << "\nВведите новые данные:\n";
-                    cout << "Новое имя (макс 10 символов): ";
-                    cin >> modified.name;
-                    cout << "Новое количество часов: ";
-                    cin >> modified.hours;
-
-                    cout << "\nСохранить изменения? (1 - Да, 0 - Нет): ";
-                    int confirm;
-                    cin >> confirm;
-
-                    if (confirm == 1) {
-                        req.cmd = CMD_WRITE_SUBMIT;
-                        req.data = modified;
-                        if (!sendRequest(req, resp)) {
-                            cout << "Ошибка при сохранении изменений\n";
-                        }
-                        else if (resp.ok) {
-                            cout << "Изменения сохранены успешно!\n";
-                        }
-                    }
-                    else {
-                        cout << "Изменения отменены\n";
-                    }
-
-                    cout << "Нажмите Enter для завершения записи...";
-                    cin.ignore();
-                    cin.get();
-
-                    req.cmd = CMD_FINISH_ACCESS;
-                    req.data = employee{};
-                    sendRequest(req, resp);
-                }
-            }
-            catch (const exception& e) {
-                cout << "Ошибка в меню: " << e.what() << endl;
-                cin.clear();
-                cin.ignore();
-            }
-        }
-
-        cout << "\nКлиент завершил работу.\n";
-        return 0;
-    }
-    catch (const exception& e) {
-        cout << "Критическая ошибка в клиенте: " << e.what() << endl;
-        return 1;
-    }
+﻿#include <clocale>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "client_api.h"
+#include "employee.h"
+#include "lock_report.h"
+using namespace std;
+
+void printRecord(const employee& e) {
+    try {
+        cout << "\n=== Запись сотрудника ===\n";
+        cout << "ID: " << e.num << endl;
+        cout << "Имя: " << e.name << endl;
+        cout << "Часы: " << e.hours << endl;
+        cout << "==========================\n";
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при выводе записи: " << e.what() << endl;
+    }
+}
+
+void printDenied(const Response& resp) {
+    switch (resp.status) {
+    case ST_NOT_FOUND:
+        cout << "Запись не найдена!\n";
+        break;
+    case ST_TIMEOUT:
+        cout << "Запись так и не освободилась за отведённое время.\n";
+        break;
+    case ST_READ_ONLY:
+        cout << "Сервер резервный и принимает только чтение.\n";
+        break;
+    case ST_OVERLOADED:
+        cout << "Сервер перегружен, повторите запрос позже.\n";
+        break;
+    default:
+        cout << "Запись занята! Попробуйте позже.\n";
+        break;
+    }
+}
+
+void printLockDump(const LockDumpHeader& header, const vector<LockDumpEntry>& entries) {
+    if (entries.empty()) {
+        cout << "Блокировок нет\n";
+        return;
+    }
+
+    cout << "ID\tКлиент\tРежим\t\tОчередь\tМс\tОтметки\n";
+    for (const LockDumpEntry& e : entries) {
+        cout << e.id << "\t" << e.pid << "\t" << lockModeName(e.mode) << "\t";
+        if (e.position != 0) cout << e.position;
+        else cout << "-";
+        cout << "\t" << e.durationMs << "\t";
+        if (e.longHold) cout << "долгое удержание ";
+        if (e.cycle != 0) cout << "цикл " << e.cycle;
+        cout << "\n";
+    }
+
+    cout << "\nСтрок: " << header.count
+        << ", удерживаются дольше " << header.holdThresholdMs << " мс: " << header.longHolds
+        << ", циклов ожидания: " << header.cycles << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        setlocale(LC_ALL, "rus");
+
+        // --wait <мс>: ждать освобождения занятой записи на сервере вместо
+        // немедленного отказа (-1 — без ограничения по времени).
+        // --server <канал>: работать с другим сервером, например с резервным.
+        // --promote: повысить этот (резервный) сервер до основного и выйти.
+        // --batch <файл>: выполнить сценарий операций без меню (- — из stdin),
+        // результаты выводятся строками через табуляцию (batch.h).
+        // --locks: вывести таблицу блокировок сервера и выйти; --hold-warn <мс> —
+        // порог, после которого удержание блокировки считается долгим.
+        int waitMs = 0;
+        string server = SERVER_PIPE_NAME;
+        bool promote = false;
+        string batchFile;
+        bool locks = false;
+        int holdWarnMs = 0;
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--wait" && i + 1 < argc) {
+                waitMs = stoi(argv[++i]);
+            }
+            else if (arg == "--server" && i + 1 < argc) {
+                server = argv[++i];
+            }
+            else if (arg == "--promote") {
+                promote = true;
+            }
+            else if (arg == "--batch" && i + 1 < argc) {
+                batchFile = argv[++i];
+            }
+            else if (arg == "--locks") {
+                locks = true;
+            }
+            else if (arg == "--hold-warn" && i + 1 < argc) {
+                holdWarnMs = stoi(argv[++i]);
+            }
+        }
+
+        if (!batchFile.empty()) {
+            ifstream file;
+            if (batchFile != "-") {
+                file.open(batchFile);
+                if (!file.is_open()) {
+                    cerr << "Не удалось открыть сценарий " << batchFile << endl;
+                    return 1;
+                }
+            }
+
+            RequestPipeline pipeline(currentProcessId(), server);
+            if (!pipeline.open()) return 1;
+
+            BatchStats stats;
+            bool completed = runBatch(batchFile == "-" ? cin : file, cout, pipeline, stats);
+            cerr << "Выполнено операций: " << stats.ok << ", с ошибкой: " << stats.failed << endl;
+            if (!completed) return 1;
+            return stats.failed == 0 ? 0 : 2;
+        }
+
+        if (locks) {
+            LockDumpHeader header;
+            vector<LockDumpEntry> entries;
+            if (!requestLockDump(currentProcessId(), holdWarnMs, header, entries, server)) {
+                return 1;
+            }
+            printLockDump(header, entries);
+            return header.cycles == 0 && header.longHolds == 0 ? 0 : 2;
+        }
+
+        if (promote) {
+            Request req{};
+            req.cmd = CMD_PROMOTE;
+            req.clientPid = currentProcessId();
+            Response resp;
+            if (!sendRequest(req, resp, server) || !resp.ok) {
+                cout << "Не удалось повысить сервер " << server << endl;
+                return 1;
+            }
+            cout << "Сервер " << server << " стал основным" << endl;
+            return 0;
+        }
+
+        cout << " Клиент \n";
+        cout << "PID процесса: " << currentProcessId() << "\n\n";
+
+        DWORD pid = currentProcessId();
+        CachedReader reader(pid, 256, server);
+
+        while (true) {
+            try {
+                cout << "\nМеню:\n";
+                cout << "1 - Чтение записи\n";
+                cout << "2 - Модификация записи\n";
+                cout << "3 - Выход\n";
+                cout << "4 - Быстрое чтение (без блокировки)\n";
+                cout << "5 - Подписка на изменения записей\n";
+                cout << "6 - Добавление записи\n";
+                cout << "7 - Удаление записи\n";
+                cout << "Выберите действие: ";
+
+                int choice = 0;
+                if (!(cin >> choice)) {
+                    // Ввод закончился: клиент выходит, сервер продолжает работу.
+                    if (cin.eof()) {
+                        reader.stop();
+                        break;
+                    }
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                }
+
+                if (choice == 3) {
+                    Request req{};
+                    req.cmd = CMD_EXIT;
+                    req.clientPid = pid;
+                    Response resp;
+                    sendRequest(req, resp, server);
+                    reader.stop();
+                    break;
+                }
+
+                if (choice < 1 || choice > 7) {
+                    cout << "Неверный выбор! Пожалуйста, выберите пункт от 1 до 7.\n";
+                    continue;
+                }
+
+                if (choice == 5) {
+                    int from, to;
+                    cout << "Введите диапазон ID (от и до): ";
+                    cin >> from >> to;
+
+                    bool subscribed = reader.subscribe(from, to, [](const vector<ChangeEvent>& batch, bool overflow) {
+                        if (overflow) {
+                            cout << "\n[Уведомление] Часть изменений пропущена, перечитайте записи\n";
+                        }
+                        for (auto& e : batch) {
+                            cout << "\n[Уведомление] Запись " << e.id
+                                << " изменена (версия " << e.version << "): "
+                                << e.data.name << ", " << e.data.hours << " ч.\n";
+                        }
+                        cout.flush();
+                    });
+                    if (!subscribed) {
+                        cout << "Не удалось оформить подписку\n";
+                    }
+                    else {
+                        cout << "Подписка оформлена\n";
+                    }
+                    continue;
+                }
+
+                cout << "Введите ID сотрудника: ";
+                int id;
+                cin >> id;
+
+                if (choice == 4) {
+                    // Последняя сохранённая версия записи без блокировки:
+                    // из кэша, разделяемой памяти сервера или проверкой версии.
+                    employee e;
+                    if (!reader.read(id, e)) {
+                        cout << "Запись не найдена!\n";
+                        continue;
+                    }
+                    printRecord(e);
+                }
+                else if (choice == 1) {
+                    Request req{};
+                    req.cmd = CMD_READ;
+                    req.id = id;
+                    req.clientPid = pid;
+                    req.waitMs = waitMs;
+
+                    Response resp;
+                    cout << "Пытаюсь прочитать запись " << id << "...\n";
+
+                    if (!sendRequest(req, resp, server)) {
+                        cout << "Ошибка соединения\n";
+                        continue;
+                    }
+
+                    if (!resp.ok) {
+                        printDenied(resp);
+                        continue;
+                    }
+
+                    printRecord(resp.data);
+
+                    cout << "Нажмите Enter для завершения чтения...";
+                    cin.ignore();
+                    cin.get();
+
+                    req.cmd = CMD_FINISH_ACCESS;
+                    sendRequest(req, resp, server);
+                }
+                else if (choice == 2) {
+                    Request req{};
+                    req.cmd = CMD_WRITE_REQUEST;
+                    req.id = id;
+                    req.clientPid = pid;
+                    req.waitMs = waitMs;
+
+                    Response resp;
+                    cout << "Пытаюсь получить доступ для записи " << id << "...\n";
+
+                    if (!sendRequest(req, resp, server)) {
+                        cout << "Ошибка соединения\n";
+                        continue;
+                    }
+
+                    if (!resp.ok) {
+                        printDenied(resp);
+                        continue;
+                    }
+
+                    cout << "\nТекущие данные:\n";
+                    printRecord(resp.data);
+
+                    employee modified = resp.data;
+                    cout << "\nВведите новые данные:\n";
+                    cout << "Новое имя (макс 10 символов): ";
+                    cin >> modified.name;
+                    cout << "Новое количество часов: ";
+                    cin >> modified.hours;
+
+                    cout << "\nСохранить изменения? (1 - Да, 0 - Нет): ";
+                    int confirm;
+                    cin >> confirm;
+
+                    if (confirm == 1) {
+                        req.cmd = CMD_WRITE_SUBMIT;
+                        req.data = modified;
+                        if (!sendRequest(req, resp, server)) {
+                            cout << "Ошибка при сохранении изменений\n";
+                        }
+                        else if (resp.ok) {
+                            cout << "Изменения сохранены успешно!\n";
+                        }
+                        else {
+                            printDenied(resp);
+                        }
+                    }
+                    else {
+                        cout << "Изменения отменены\n";
+                    }
+
+                    cout << "Нажмите Enter для завершения записи...";
+                    cin.ignore();
+                    cin.get();
+
+                    req.cmd = CMD_FINISH_ACCESS;
+                    req.data = employee{};
+                    sendRequest(req, resp, server);
+                }
+                else if (choice == 6) {
+                    Request req{};
+                    req.cmd = CMD_INSERT;
+                    req.id = id;
+                    req.clientPid = pid;
+                    req.data.num = id;
+                    cout << "Имя (макс 10 символов): ";
+                    cin >> req.data.name;
+                    cout << "Количество часов: ";
+                    cin >> req.data.hours;
+
+                    Response resp;
+                    if (!sendRequest(req, resp, server)) {
+                        cout << "Ошибка соединения\n";
+                    }
+                    else if (resp.ok) {
+                        cout << "Запись добавлена\n";
+                    }
+                    else if (resp.status == ST_EXISTS) {
+                        cout << "Запись с таким ID уже существует!\n";
+                    }
+                    else {
+                        printDenied(resp);
+                    }
+                }
+                else if (choice == 7) {
+                    Request req{};
+                    req.cmd = CMD_DELETE;
+                    req.id = id;
+                    req.clientPid = pid;
+
+                    Response resp;
+                    if (!sendRequest(req, resp, server)) {
+                        cout << "Ошибка соединения\n";
+                    }
+                    else if (resp.ok) {
+                        cout << "Запись удалена\n";
+                    }
+                    else {
+                        printDenied(resp);
+                    }
+                }
+            }
+            catch (const exception& e) {
+                cout << "Ошибка в меню: " << e.what() << endl;
+                cin.clear();
+                cin.ignore();
+            }
+        }
+
+        cout << "\nКлиент завершил работу.\n";
+        return 0;
+    }
+    catch (const exception& e) {
+        cout << "Критическая ошибка в клиенте: " << e.what() << endl;
+        return 1;
+    }
 }
\ No newline at end of file
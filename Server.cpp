@@ -1,421 +1,1859 @@
-﻿#include <windows.h>
-#include <iostream>
-#include <fstream>
-#include <map>
-#include <string>
-#include <vector>
-#include "employee.h"
-using namespace std;
-
-struct RecordLock {
-    HANDLE mutex;
-    HANDLE writeSemaphore;
-    int readerCount;
-    int writerCount;
-
-    RecordLock() {
-        readerCount = 0;
-        writerCount = 0;
-        mutex = CreateMutex(NULL, FALSE, NULL);
-        writeSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
-    }
-
-    ~RecordLock() {
-        CloseHandle(mutex);
-        CloseHandle(writeSemaphore);
-    }
-};
-
-map<int, employee> database;
-map<int, RecordLock*> locks;
-map<DWORD, int> clientOperations;
-
-HANDLE hServerPipe;
-string filename;
-
-bool beginRead(int id) {
-    RecordLock* lock = locks[id];
-    if (!lock) return false;
-
-    WaitForSingleObject(lock->mutex, INFINITE);
-
-    if (lock->writerCount > 0) {
-        ReleaseMutex(lock->mutex);
-        return false;
-    }
-
-    lock->readerCount++;
-    ReleaseMutex(lock->mutex);
-    return true;
-}
-
-void endRead(int id) {
-    RecordLock* lock = locks[id];
-    if (!lock) return;
-
-    WaitForSingleObject(lock->mutex, INFINITE);
-    lock->readerCount--;
-    ReleaseMutex(lock->mutex);
-}
-
-bool beginWrite(int id) {
-    RecordLock* lock = locks[id];
-    if (!lock) return false;
-
-    if (WaitForSingleObject(lock->writeSemaphore, 0) != WAIT_OBJECT_0) {
-        return false;
-    }
-
-    WaitForSingleObject(lock->mutex, INFINITE);
-
-    while (lock->readerCount > 0) {
-        ReleaseMutex(lock->mutex);
-        Sleep(10);
-        WaitForSingleObject(lock->mutex, INFINITE);
-    }
-
-    lock->writerCount = 1;
-    ReleaseMutex(lock->mutex);
-    return true;
-}
-
-void endWrite(int id) {
-    RecordLock* lock = locks[id];
-    if (!lock) return;
-
-    WaitForSingleObject(lock->mutex, INFINITE);
-    lock->writerCount = 0;
-    ReleaseMutex(lock->mutex);
-
-    ReleaseSemaphore(lock->writeSemaphore, 1, NULL);
-}
-
-void loadFile() {
-    try {
-        ifstream f(filename, ios::binary);
-        if (!f.is_open()) {
-            cout << "Не удалось открыть файл для чтения\n";
-            cout.flush();
-            return;
-        }
-
-        employee e;
-        while (f.read((char*)&e, sizeof(e))) {
-            database[e.num] = e;
-            if (!locks[e.num]) {
-                locks[e.num] = new RecordLock();
-            }
-        }
-        f.close();
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при загрузке файла: " << e.what() << endl;
-        cout.flush();
-    }
-}
-
-void saveFile() {
-    try {
-        ofstream f(filename, ios::binary | ios::trunc);
-        if (!f.is_open()) {
-            cout << "Не удалось открыть файл для записи\n";
-            cout.flush();
-            return;
-        }
-
-        for (auto& p : database) {
-            f.write((char*)&p.second, sizeof(employee));
-        }
-        f.close();
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при сохранении файла: " << e.what() << endl;
-        cout.flush();
-    }
-}
-
-void printFile() {
-    try {
-        cout << "\nСодержимое файла:\n";
-        cout.flush();
-        cout << "ID\tИмя\tЧасы\n";
-        cout.flush();
-        cout << "----------------------\n";
-        cout.flush();
-        for (auto& p : database) {
-            cout << p.second.num << "\t"
-                << p.second.name << "\t"
-                << p.second.hours << endl;
-            cout.flush();
-        }
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при выводе данных: " << e.what() << endl;
-        cout.flush();
-    }
-}
-
-void sendResponse(DWORD pid, const Response& resp) {
-    try {
-        string pipeName = "\\\\.\\pipe\\client_pipe_" + to_string(pid);
-        HANDLE hNamedPipe = CreateFileA(
-            pipeName.c_str(),
-            GENERIC_WRITE,
-            0, NULL,
-            OPEN_EXISTING,
-            0, NULL);
-
-        if (hNamedPipe != INVALID_HANDLE_VALUE) {
-            DWORD written;
-            WriteFile(hNamedPipe, &resp, sizeof(resp), &written, NULL);
-            CloseHandle(hNamedPipe);
-        }
-        else {
-            cout << "Ошибка отправки ответа клиенту " << pid << endl;
-            cout.flush();
-        }
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при отправке ответа клиенту " << pid << ": " << e.what() << endl;
-        cout.flush();
-    }
-}
-
-void processRequest(const Request& req) {
-    try {
-        Response resp{};
-        int id = req.id;
-
-        if (!locks[id]) {
-            locks[id] = new RecordLock();
-        }
-
-        RecordLock* lock = locks[id];
-
-        switch (req.cmd) {
-        case CMD_READ:
-            if (beginRead(id)) {
-                clientOperations[req.clientPid] = CMD_READ;
-                resp.ok = database.count(id);
-                if (resp.ok) {
-                    resp.data = database[id];
-                    cout << "Клиент " << req.clientPid
-                        << " начал чтение записи " << id
-                        << " (читателей: " << lock->readerCount << ")" << endl;
-                    cout.flush();
-                }
-                else {
-                    resp.data = employee{};
-                    endRead(id);
-                }
-            }
-            else {
-                resp.ok = false;
-                cout << "Клиент " << req.clientPid
-                    << " не смог прочитать запись " << id << " (занята писателем)" << endl;
-                cout.flush();
-            }
-            sendResponse(req.clientPid, resp);
-            break;
-
-        case CMD_WRITE_REQUEST:
-            if (beginWrite(id)) {
-                clientOperations[req.clientPid] = CMD_WRITE_REQUEST;
-                resp.ok = database.count(id);
-                if (resp.ok) {
-                    resp.data = database[id];
-                    cout << "Клиент " << req.clientPid
-                        << " начал запись в запись " << id << endl;
-                    cout.flush();
-                }
-                else {
-                    resp.data = employee{};
-                }
-            }
-            else {
-                resp.ok = false;
-                cout << "Клиент " << req.clientPid
-                    << " не смог получить доступ для записи " << id << " (занято)" << endl;
-                cout.flush();
-            }
-            sendResponse(req.clientPid, resp);
-            break;
-
-        case CMD_WRITE_SUBMIT:
-            if (database.count(id)) {
-                database[id] = req.data;
-                resp.ok = true;
-                cout << "Клиент " << req.clientPid
-                    << " сохранил изменения записи " << id << endl;
-                cout.flush();
-            }
-            else {
-                resp.ok = false;
-            }
-            sendResponse(req.clientPid, resp);
-            break;
-
-        case CMD_FINISH_ACCESS:
-            if (clientOperations.count(req.clientPid)) {
-                int cmd = clientOperations[req.clientPid];
-                if (cmd == CMD_READ) {
-                    endRead(id);
-                    cout << "Клиент " << req.clientPid
-                        << " завершил чтение записи " << id << endl;
-                    cout.flush();
-                }
-                else if (cmd == CMD_WRITE_REQUEST) {
-                    endWrite(id);
-                    cout << "Клиент " << req.clientPid
-                        << " завершил запись в запись " << id << endl;
-                    cout.flush();
-                }
-                clientOperations.erase(req.clientPid);
-            }
-            resp.ok = true;
-            sendResponse(req.clientPid, resp);
-            break;
-        }
-    }
-    catch (const exception& e) {
-        cout << "Ошибка при обработке запроса: " << e.what() << endl;
-        cout.flush();
-    }
-}
-
-int main() {
-    try {
-        setlocale(LC_ALL, "rus");
-
-        cout << " Сервер " << endl;
-        cout.flush();
-
-        cout << "Введите имя файла: ";
-        cout.flush();
-        cin >> filename;
-
-        cout << "Количество сотрудников: ";
-        cout.flush();
-        int n;
-        cin >> n;
-
-        ofstream f(filename, ios::binary | ios::trunc);
-        if (!f.is_open()) {
-            cout << "Ошибка создания файла!\n";
-            cout.flush();
-            return 1;
-        }
-
-        for (int i = 0; i < n; i++) {
-            employee e;
-            cout << "\nСотрудник " << (i + 1) << ":\n";
-            cout.flush();
-            cout << "  ID: ";
-            cout.flush();
-            cin >> e.num;
-            cout << "  Имя (max 10 символов): ";
-            cout.flush();
-            cin >> e.name;
-            cout << "  Часы: ";
-            cout.flush();
-            cin >> e.hours;
-            f.write((char*)&e, sizeof(e));
-            locks[e.num] = new RecordLock();
-        }
-        f.close();
-
-        loadFile();
-        printFile();
-
-        cout << "\nВведите количество клиентов: ";
-        cout.flush();
-        int clientCount;
-        cin >> clientCount;
-        cout << "Ожидаю до " << clientCount << " клиентов...\n";
-        cout.flush();
-
-        cout << "\nСервер запущен. Ожидаю клиентов...\n";
-        cout.flush();
-
-        while (true) {
-            hServerPipe = CreateNamedPipeA(
-                "\\\\.\\pipe\\server_pipe",
-                PIPE_ACCESS_INBOUND,
-                PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
-                PIPE_UNLIMITED_INSTANCES,
-                sizeof(Request),
-                sizeof(Response),
-                0,
-                NULL);
-
-            if (hServerPipe == INVALID_HANDLE_VALUE) {
-                cout << "Ошибка создания канала: " << GetLastError() << endl;
-                cout.flush();
-                break;
-            }
-
-            cout << "Ожидание подключения клиента..." << endl;
-            cout.flush();
-            if (!ConnectNamedPipe(hServerPipe, NULL)) {
-                DWORD err = GetLastError();
-                if (err != ERROR_PIPE_CONNECTED) {
-                    cout << "Ошибка подключения: " << err << endl;
-                    cout.flush();
-                    CloseHandle(hServerPipe);
-                    continue;
-                }
-            }
-
-            cout << "Клиент подключен" << endl;
-            cout.flush();
-
-            Request req;
-            DWORD bytesRead;
-            if (ReadFile(hServerPipe, &req, sizeof(req), &bytesRead, NULL)) {
-                if (req.cmd == CMD_EXIT) {
-                    cout << "Получена команда завершения работы" << endl;
-                    cout.flush();
-                    CloseHandle(hServerPipe);
-                    break;
-                }
-
-                processRequest(req);
-            }
-            else {
-                cout << "Ошибка чтения запроса: " << GetLastError() << endl;
-                cout.flush();
-            }
-
-            CloseHandle(hServerPipe);
-        }
-
-        saveFile();
-        cout << "\nФинальное состояние файла:\n";
-        cout.flush();
-        printFile();
-
-        for (auto& pair : locks) {
-            delete pair.second;
-        }
-        locks.clear();
-
-        cout << "\nСервер завершил работу.\n";
-        cout.flush();
-        return 0;
-    }
-    catch (const exception& e) {
-        cout << "Критическая ошибка в работе сервера: " << e.what() << endl;
-        cout.flush();
-
-        for (auto& pair : locks) {
-            delete pair.second;
-        }
-        locks.clear();
-
-        if (hServerPipe != INVALID_HANDLE_VALUE && hServerPipe != NULL) {
-            CloseHandle(hServerPipe);
-        }
-
-        return 1;
-    }
+﻿#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "admission.h"
+#include "client_api.h"
+#include "employee.h"
+#include "lock_report.h"
+#include "object_pool.h"
+#include "record_format.h"
+#include "replication.h"
+#include "ring_buffer.h"
+#include "shared_store.h"
+#include "snapshot.h"
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// Клиент, ожидающий блокировку записи (запрос с waitMs != 0).
+struct LockWaiter {
+    DWORD pid;
+    std::uint32_t seq;
+    CommandType cmd;
+    bool hasDeadline;
+    Clock::time_point deadline;
+    Clock::time_point since;
+};
+
+typedef deque<LockWaiter> WaitQueue;
+
+// Слово блокировки записи: больше нуля — число читателей, LOCK_WRITER — писатель.
+const int32_t LOCK_WRITER = -1;
+
+// Запись в памяти: поля, версия, слово блокировки и номер слота в файле
+// лежат в одной строке кэша, поэтому проверка блокировки и ответ на чтение
+// не обращаются к другим объектам. Очередь ожидания заводится только для
+// записей, за которые шла конкуренция. Блокировки меняет только главный
+// поток, поэтому слово блокировки не атомарное.
+struct alignas(64) RecordSlot {
+    employee data;
+    uint32_t version;
+    int32_t lockWord;
+    uint32_t fileSlot;
+    WaitQueue* waiters;
+
+    RecordSlot(const employee& e, uint32_t v, size_t slot)
+        : data(e), version(v), lockWord(0), fileSlot((uint32_t)slot), waiters(nullptr) {}
+};
+
+static_assert(sizeof(RecordSlot) == 64, "RecordSlot должен занимать одну строку кэша");
+
+// Подписка клиента на изменения. Недоставленные события сливаются по ID
+// записи; если их накопилось больше MAX_PENDING_EVENTS, подписчик получает
+// пустую пачку с overflow и перечитывает записи сам.
+// Подписчику, которому давно ничего не отправлялось, уходит пустая пачка
+// (пульс, SUBSCRIPTION_HEARTBEAT_MS): по ней клиент знает, что подписка жива.
+struct Subscriber {
+    vector<pair<int, int>> ranges;
+    map<int, ChangeEvent> pending;
+    bool overflow;
+    Clock::time_point lastSent;
+
+    Subscriber() : overflow(false), lastSent(Clock::now()) {}
+};
+
+const size_t MAX_PENDING_EVENTS = 256;
+
+// Блокировка записи, которую удерживает клиент.
+struct HeldLock {
+    int id;
+    int cmd;
+    Clock::time_point since;
+};
+
+// Блокировка, удерживаемая дольше, отмечается в таблице блокировок
+// (CMD_LOCK_DUMP), если клиент не задал свой порог.
+const uint32_t LONG_HOLD_MS = 5000;
+
+// Состояние клиента на сервере. Адрес канала ответа вычисляется один раз,
+// а место под удерживаемые блокировки резервируется заранее, поэтому
+// ответы на чтение и запись не выделяют память.
+const size_t SESSION_HELD_RESERVE = 8;
+
+// Клиент, который ничего не держит и не получал ответов дольше
+// SESSION_IDLE_MS, забывается: клиенты не сообщают о своём завершении.
+// Срок много больше паузы человека между пунктами меню, чтобы сессия
+// работающего клиента не создавалась заново на каждом запросе.
+const int SESSION_IDLE_MS = 30000;
+
+struct Session {
+    DWORD pid;
+    ipc::Endpoint reply;
+    vector<HeldLock> held;
+    Clock::time_point lastActive;
+
+    explicit Session(DWORD clientPid)
+        : pid(clientPid), reply(clientPipeName(clientPid)), lastActive(Clock::now()) {
+        held.reserve(SESSION_HELD_RESERVE);
+    }
+};
+
+// Изменённые записи сохраняются контрольной точкой не реже, чем раз в
+// CHECKPOINT_INTERVAL_MS, или сразу, когда их набралось CHECKPOINT_BATCH.
+const int CHECKPOINT_INTERVAL_MS = 1000;
+const size_t CHECKPOINT_BATCH = 64;
+
+// Уплотнение файла начинается, когда свободна хотя бы четверть слотов,
+// и переносит за одну контрольную точку не больше COMPACTION_STEP записей.
+const size_t COMPACTION_STEP = 64;
+
+unordered_map<int, RecordSlot*> records;
+ObjectPool<RecordSlot> recordPool;
+ObjectPool<WaitQueue> waitQueuePool;
+// Версия удалённой записи: добавленная заново запись продолжает нумерацию,
+// иначе клиентский кэш примет её за прежнюю.
+unordered_map<int, uint32_t> retiredVersions;
+vector<int> slotIds;
+set<size_t> freeSlots;
+// Изменённые слоты: список для контрольной точки и флаг на слот, чтобы
+// не добавлять слот в список дважды.
+vector<size_t> dirty;
+vector<char> dirtyFlags;
+map<DWORD, Session*> sessions;
+ObjectPool<Session> sessionPool;
+multimap<Clock::time_point, int> waitDeadlines;
+// Записи с непустой очередью ожидания: таблица блокировок и поиск циклов
+// ожидания обходят только их, а не все записи.
+set<int> contended;
+
+// Резервный сервер (--replica-of) применяет поток изменений основного и
+// отвечает только на чтение, пока его не повысят командой CMD_PROMOTE.
+// После повышения он принимает запросы и под именем прежнего основного.
+bool standby = false;
+string serverName = SERVER_PIPE_NAME;
+// Эпоха выбирается при запуске и приходит клиентам в каждом ответе
+// (Response::epoch): версии записей после перезапуска начинаются заново.
+uint32_t serverEpoch = 0;
+string primaryName;
+ReplicationSource replication;
+ReplicationSink replicationSink;
+// Резервный, не получивший от основного ни одной пачки (даже пустой)
+// за REPLICA_SILENCE_MS, подключается к нему заново не чаще этого же интервала.
+const unsigned REPLICA_SILENCE_MS = REPLICATION_HEARTBEAT_MS * 4;
+Clock::time_point nextReattach;
+// Номер последнего зафиксированного изменения (на резервном — применённого).
+uint64_t commitLsn = 0;
+
+ipc::Listener serverPipe;
+ipc::Listener primaryPipe;
+SharedStore sharedStore;
+Checkpointer checkpointer;
+Clock::time_point nextCheckpoint;
+string filename;
+
+// Запросы принимает отдельный поток, а обрабатывает только главный:
+// так главный поток может проснуться по истечении срока ожидания блокировки.
+// Поток приёма раскладывает запросы по очередям клиентов и сразу отказывает
+// в том, что превышает ограничения; главный поток берёт запросы по кругу.
+mutex incomingMutex;
+condition_variable incomingReady;
+AdmissionQueue incoming;
+
+// Пачки изменений от основного сервера; применяет их тоже главный поток.
+struct ReplicatedBatch {
+    vector<ChangeEvent> events;
+    bool reset;
+    uint64_t lsn;
+};
+RingBuffer<ReplicatedBatch> replicated(4);
+
+// Уведомления рассылает отдельный поток, чтобы медленный подписчик не
+// задерживал обработку запросов.
+mutex subscribersMutex;
+condition_variable eventsReady;
+map<DWORD, Subscriber> subscribers;
+bool eventsPending = false;
+bool notifierStop = false;
+
+RecordSlot* findRecord(int id) {
+    auto it = records.find(id);
+    return it == records.end() ? nullptr : it->second;
+}
+
+bool hasWaiters(const RecordSlot* r) {
+    return r->waiters && !r->waiters->empty();
+}
+
+Session* sessionFor(DWORD pid) {
+    auto it = sessions.find(pid);
+    if (it != sessions.end()) {
+        it->second->lastActive = Clock::now();
+        return it->second;
+    }
+
+    Session* session = sessionPool.acquire(pid);
+    sessions[pid] = session;
+    return session;
+}
+
+// Режим, в котором клиент держит запись, или -1, если не держит.
+int heldMode(DWORD pid, int id) {
+    auto it = sessions.find(pid);
+    if (it == sessions.end()) return -1;
+    for (const HeldLock& h : it->second->held) {
+        if (h.id == id) return h.cmd;
+    }
+    return -1;
+}
+
+void dropHeld(DWORD pid, int id) {
+    auto it = sessions.find(pid);
+    if (it == sessions.end()) return;
+
+    vector<HeldLock>& held = it->second->held;
+    for (size_t i = 0; i < held.size(); i++) {
+        if (held[i].id == id) {
+            held[i] = held.back();
+            held.pop_back();
+            return;
+        }
+    }
+}
+
+// Клиент недоступен и ничего не держит — его состояние больше не нужно.
+void closeIdleSession(DWORD pid) {
+    auto it = sessions.find(pid);
+    if (it == sessions.end() || !it->second->held.empty()) return;
+
+    sessionPool.release(it->second);
+    sessions.erase(it);
+}
+
+// Раз в SESSION_IDLE_MS освобождает простаивающих клиентов без блокировок,
+// как AdmissionQueue::prune — клиентов без запросов.
+Clock::time_point nextSessionPrune;
+
+void pruneSessions() {
+    Clock::time_point now = Clock::now();
+    if (now < nextSessionPrune) return;
+    nextSessionPrune = now + chrono::milliseconds(SESSION_IDLE_MS);
+
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        Session* session = it->second;
+        bool idle = now - session->lastActive >= chrono::milliseconds(SESSION_IDLE_MS);
+        if (session->held.empty() && idle) {
+            sessionPool.release(session);
+            it = sessions.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+// queued = true, когда доступ выдаётся из очереди ожидания: тогда
+// стоящие позади в очереди не мешают. Иначе новый запрос не обгоняет очередь.
+bool beginRead(int id, bool queued = false) {
+    RecordSlot* r = findRecord(id);
+    if (!r) return false;
+
+    if (r->lockWord == LOCK_WRITER || (!queued && hasWaiters(r))) {
+        return false;
+    }
+
+    r->lockWord++;
+    return true;
+}
+
+void endRead(int id) {
+    RecordSlot* r = findRecord(id);
+    if (!r || r->lockWord <= 0) return;
+
+    r->lockWord--;
+}
+
+// Сервер обрабатывает запросы в одном потоке, поэтому ждать здесь ухода
+// читателей нельзя: они освободят запись только следующими запросами.
+bool beginWrite(int id, bool queued = false) {
+    RecordSlot* r = findRecord(id);
+    if (!r) return false;
+
+    if (r->lockWord != 0 || (!queued && hasWaiters(r))) {
+        return false;
+    }
+
+    r->lockWord = LOCK_WRITER;
+    return true;
+}
+
+void endWrite(int id) {
+    RecordSlot* r = findRecord(id);
+    if (!r || r->lockWord != LOCK_WRITER) return;
+
+    r->lockWord = 0;
+}
+
+// Запись, не поместившаяся в разделяемую память, читается клиентами через
+// сервер; о переполнении сообщается один раз.
+bool sharedStoreFull = false;
+
+void publishShared(const employee& e, uint32_t version) {
+    if (sharedStore.publish(e, version) || !sharedStore.isOpen() || sharedStoreFull) return;
+
+    sharedStoreFull = true;
+    cout << "Разделяемая память заполнена: запись " << e.num
+        << " и следующие новые записи читаются только через сервер" << endl;
+    cout.flush();
+}
+
+void markDirty(size_t slot) {
+    if (dirty.empty()) {
+        nextCheckpoint = Clock::now() + chrono::milliseconds(CHECKPOINT_INTERVAL_MS);
+    }
+    if (slot >= dirtyFlags.size()) dirtyFlags.resize(slot + 1, 0);
+    if (dirtyFlags[slot]) return;
+    dirtyFlags[slot] = 1;
+    dirty.push_back(slot);
+}
+
+// Слот для новой записи: сначала самый первый освободившийся, иначе в конце файла.
+size_t allocateSlot(int id) {
+    size_t slot;
+    if (!freeSlots.empty()) {
+        slot = *freeSlots.begin();
+        freeSlots.erase(freeSlots.begin());
+        slotIds[slot] = id;
+    }
+    else {
+        slot = slotIds.size();
+        slotIds.push_back(id);
+    }
+    markDirty(slot);
+    return slot;
+}
+
+void releaseSlot(size_t slot) {
+    slotIds[slot] = TOMBSTONE_ID;
+    freeSlots.insert(slot);
+    markDirty(slot);
+}
+
+bool loadFile() {
+    try {
+        vector<employee> loaded;
+        RecordFileStatus status = readRecordFile(filename, loaded);
+        if (status == RF_OPEN_FAILED) {
+            cout << "Не удалось открыть файл для чтения\n";
+            cout.flush();
+            return false;
+        }
+        if (status == RF_CORRUPTED) {
+            cout << "Файл повреждён: не совпадает заголовок, контрольная сумма или размер\n";
+            cout.flush();
+            return false;
+        }
+        if (status == RF_LEGACY) {
+            // Контрольные точки дописывают файл только в формате версии 2.
+            if (!writeRecordFile(filename, loaded)) {
+                cout << "Не удалось перевести файл в формат версии 2\n";
+                cout.flush();
+                return false;
+            }
+            cout << "Файл переведён в формат версии 2\n";
+            cout.flush();
+        }
+
+        for (const employee& e : loaded) {
+            size_t slot = slotIds.size();
+            if (e.num == TOMBSTONE_ID) {
+                slotIds.push_back(TOMBSTONE_ID);
+                freeSlots.insert(slot);
+                continue;
+            }
+            slotIds.push_back(e.num);
+
+            // При повторе ID действует последняя копия, прежний слот освобождается.
+            RecordSlot* r = findRecord(e.num);
+            if (r) {
+                releaseSlot(r->fileSlot);
+                r->data = e;
+                r->fileSlot = (uint32_t)slot;
+            }
+            else {
+                r = recordPool.acquire(e, 0, slot);
+                records[e.num] = r;
+            }
+            publishShared(e, r->version);
+        }
+        return true;
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при загрузке файла: " << e.what() << endl;
+        cout.flush();
+        return false;
+    }
+}
+
+// Переносит записи из конца файла в свободные слоты и отрезает свободный
+// хвост. Перенос и усечение попадают в один снимок, поэтому в файле
+// никогда не бывает двух копий записи или потерянной записи.
+void compactSlots() {
+    size_t moved = 0;
+    while (!freeSlots.empty()) {
+        size_t tail = slotIds.size() - 1;
+        if (slotIds[tail] == TOMBSTONE_ID) {
+            freeSlots.erase(tail);
+            if (tail < dirtyFlags.size()) dirtyFlags[tail] = 0;
+            slotIds.pop_back();
+            continue;
+        }
+        if (freeSlots.size() * 4 < slotIds.size() || moved >= COMPACTION_STEP) break;
+
+        size_t hole = *freeSlots.begin();
+        freeSlots.erase(freeSlots.begin());
+        int id = slotIds[tail];
+        slotIds[hole] = id;
+        records[id]->fileSlot = (uint32_t)hole;
+        markDirty(hole);
+
+        slotIds[tail] = TOMBSTONE_ID;
+        freeSlots.insert(tail);
+        moved++;
+    }
+}
+
+// Главный поток только копирует изменённые записи; файл пишет поток
+// контрольных точек, поэтому обработка запросов не останавливается.
+void flushDirty() {
+    compactSlots();
+
+    map<size_t, employee> changed;
+    for (size_t slot : dirty) {
+        // Слот мог быть отрезан уплотнением после того, как попал в список.
+        if (slot >= slotIds.size() || !dirtyFlags[slot]) continue;
+        dirtyFlags[slot] = 0;
+        if (slotIds[slot] == TOMBSTONE_ID) {
+            employee tombstone{};
+            tombstone.num = TOMBSTONE_ID;
+            changed[slot] = tombstone;
+        }
+        else {
+            changed[slot] = records[slotIds[slot]]->data;
+        }
+    }
+    dirty.clear();
+    checkpointer.submit(changed, slotIds.size());
+}
+
+void maybeCheckpoint() {
+    if (!dirty.empty() && (dirty.size() >= CHECKPOINT_BATCH || Clock::now() >= nextCheckpoint)) {
+        flushDirty();
+    }
+}
+
+void printFile() {
+    try {
+        cout << "\nСодержимое файла:\n";
+        cout.flush();
+        cout << "ID\tИмя\tЧасы\n";
+        cout.flush();
+        cout << "----------------------\n";
+        cout.flush();
+        vector<int> ids;
+        ids.reserve(records.size());
+        for (auto& p : records) ids.push_back(p.first);
+        sort(ids.begin(), ids.end());
+
+        for (int id : ids) {
+            const employee& e = records[id]->data;
+            cout << e.num << "\t"
+                << e.name << "\t"
+                << e.hours << endl;
+            cout.flush();
+        }
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при выводе данных: " << e.what() << endl;
+        cout.flush();
+    }
+}
+
+bool sendResponse(DWORD pid, Response resp) {
+    resp.epoch = serverEpoch;
+    try {
+        ipc::Connection conn;
+        if (ipc::connect(sessionFor(pid)->reply, conn) && conn.sendAll(&resp, sizeof(resp))) {
+            return true;
+        }
+        cout << "Ошибка отправки ответа клиенту " << pid << endl;
+        cout.flush();
+        closeIdleSession(pid);
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при отправке ответа клиенту " << pid << ": " << e.what() << endl;
+        cout.flush();
+    }
+    return false;
+}
+
+// Отвечает клиенту, получившему блокировку. Если клиент уже недоступен,
+// блокировка снимается, иначе запись останется занятой навсегда.
+bool grantAccess(DWORD pid, CommandType cmd, int id, uint32_t seq) {
+    RecordSlot* r = findRecord(id);
+    Response resp{};
+    resp.seq = seq;
+    resp.ok = true;
+    resp.status = ST_OK;
+    resp.data = r->data;
+    resp.version = r->version;
+
+    sessionFor(pid)->held.push_back(HeldLock{ id, cmd, Clock::now() });
+    if (cmd == CMD_READ) {
+        cout << "Клиент " << pid
+            << " начал чтение записи " << id
+            << " (читателей: " << r->lockWord << ")" << endl;
+    }
+    else {
+        cout << "Клиент " << pid
+            << " начал запись в запись " << id << endl;
+    }
+    cout.flush();
+
+    if (sendResponse(pid, resp)) return true;
+
+    dropHeld(pid, id);
+    closeIdleSession(pid);
+    if (cmd == CMD_READ) endRead(id);
+    else endWrite(id);
+    return false;
+}
+
+// Выдаёт блокировку ожидающим в порядке очереди: писателю — когда запись
+// свободна, подряд идущим читателям — пока нет писателя.
+void grantWaiters(int id) {
+    RecordSlot* r = findRecord(id);
+    if (!r || !r->waiters) return;
+
+    WaitQueue& waiters = *r->waiters;
+    while (!waiters.empty()) {
+        LockWaiter w = waiters.front();
+        bool granted = w.cmd == CMD_READ ? beginRead(id, true) : beginWrite(id, true);
+        if (!granted) break;
+
+        waiters.pop_front();
+        if (waiters.empty()) contended.erase(id);
+        grantAccess(w.pid, w.cmd, id, w.seq);
+    }
+}
+
+uint32_t elapsedMs(Clock::time_point since, Clock::time_point now) {
+    return (uint32_t)chrono::duration_cast<chrono::milliseconds>(now - since).count();
+}
+
+void appendHeld(DWORD pid, const Session* session, bool contendedOnly,
+    Clock::time_point now, vector<LockDumpEntry>& entries) {
+    for (const HeldLock& h : session->held) {
+        if (contendedOnly && contended.count(h.id) == 0) continue;
+
+        LockDumpEntry e{};
+        e.id = h.id;
+        e.pid = pid;
+        e.mode = h.cmd == CMD_READ ? LOCK_HELD_READ : LOCK_HELD_WRITE;
+        e.durationMs = elapsedMs(h.since, now);
+        entries.push_back(e);
+    }
+}
+
+void appendWaiters(Clock::time_point now, vector<LockDumpEntry>& entries) {
+    for (int id : contended) {
+        uint32_t position = 1;
+        for (const LockWaiter& w : *findRecord(id)->waiters) {
+            LockDumpEntry e{};
+            e.id = id;
+            e.pid = w.pid;
+            e.mode = w.cmd == CMD_READ ? LOCK_WAIT_READ : LOCK_WAIT_WRITE;
+            e.position = position++;
+            e.durationMs = elapsedMs(w.since, now);
+            entries.push_back(e);
+        }
+    }
+}
+
+void sortLocks(vector<LockDumpEntry>& entries) {
+    sort(entries.begin(), entries.end(), [](const LockDumpEntry& a, const LockDumpEntry& b) {
+        if (a.id != b.id) return a.id < b.id;
+        return a.position < b.position;
+    });
+}
+
+// Строки таблицы блокировок: по записям, в каждой сначала держатели,
+// затем ожидающие в порядке очереди.
+void collectLocks(vector<LockDumpEntry>& entries) {
+    Clock::time_point now = Clock::now();
+    entries.clear();
+
+    for (auto& p : sessions) {
+        appendHeld(p.first, p.second, false, now, entries);
+    }
+    appendWaiters(now, entries);
+    sortLocks(entries);
+}
+
+// Граф ожидания для поиска циклов: в цикл входят только ожидающие клиенты
+// и только спорные записи, поэтому держатели берутся лишь у ожидающих и
+// лишь по записям из contended.
+void collectWaitGraph(vector<LockDumpEntry>& entries) {
+    Clock::time_point now = Clock::now();
+    entries.clear();
+
+    appendWaiters(now, entries);
+    set<DWORD> waiting;
+    for (const LockDumpEntry& e : entries) waiting.insert(e.pid);
+    for (DWORD pid : waiting) {
+        auto it = sessions.find(pid);
+        if (it != sessions.end()) appendHeld(pid, it->second, true, now, entries);
+    }
+    sortLocks(entries);
+}
+
+// Вставший в очередь клиент мог замкнуть цикл ожидания. Сервер его не
+// разрывает: ожидающих освободит срок ожидания, — но сообщает о нём сразу.
+void reportWaitCycle(DWORD pid, int id) {
+    vector<LockDumpEntry> entries;
+    collectWaitGraph(entries);
+    if (markWaitCycles(entries) == 0) return;
+
+    uint32_t cycle = 0;
+    for (const LockDumpEntry& e : entries) {
+        if (e.pid == pid && e.id == id && isWaiting(e.mode)) cycle = e.cycle;
+    }
+    if (cycle == 0) return;
+
+    cout << "Обнаружена взаимная блокировка:";
+    for (const LockDumpEntry& e : entries) {
+        if (e.cycle == cycle) cout << " клиент " << e.pid << " ждёт запись " << e.id << ";";
+    }
+    cout << endl;
+    cout.flush();
+}
+
+void sendLockDump(const Request& req) {
+    vector<LockDumpEntry> entries;
+    collectLocks(entries);
+
+    LockDumpHeader header{};
+    header.count = (uint32_t)entries.size();
+    header.holdThresholdMs = req.waitMs > 0 ? (uint32_t)req.waitMs : LONG_HOLD_MS;
+    header.cycles = (uint32_t)markWaitCycles(entries);
+    header.longHolds = (uint32_t)markLongHolds(entries, header.holdThresholdMs);
+
+    Response resp{};
+    resp.seq = req.seq;
+    resp.ok = true;
+    resp.epoch = serverEpoch;
+
+    ipc::Connection conn;
+    bool sent = ipc::connect(sessionFor(req.clientPid)->reply, conn)
+        && conn.sendAll(&resp, sizeof(resp))
+        && conn.sendAll(&header, sizeof(header))
+        && (entries.empty() || conn.sendAll(entries.data(), entries.size() * sizeof(LockDumpEntry)));
+    if (!sent) {
+        cout << "Ошибка отправки таблицы блокировок клиенту " << req.clientPid << endl;
+        cout.flush();
+        closeIdleSession(req.clientPid);
+        return;
+    }
+
+    cout << "Клиент " << req.clientPid << " получил таблицу блокировок (строк: "
+        << header.count << ", циклов ожидания: " << header.cycles
+        << ", долгих удержаний: " << header.longHolds << ")" << endl;
+    cout.flush();
+}
+
+void enqueueWaiter(const Request& req) {
+    LockWaiter w;
+    w.pid = req.clientPid;
+    w.seq = req.seq;
+    w.cmd = req.cmd;
+    w.since = Clock::now();
+    w.hasDeadline = req.waitMs > 0;
+    if (w.hasDeadline) {
+        w.deadline = w.since + chrono::milliseconds(req.waitMs);
+        waitDeadlines.insert(make_pair(w.deadline, req.id));
+    }
+    RecordSlot* r = findRecord(req.id);
+    if (!r->waiters) r->waiters = waitQueuePool.acquire();
+    r->waiters->push_back(w);
+    contended.insert(req.id);
+
+    cout << "Клиент " << req.clientPid
+        << " ожидает доступа к записи " << req.id
+        << " (в очереди: " << r->waiters->size() << ")" << endl;
+    cout.flush();
+
+    reportWaitCycle(req.clientPid, req.id);
+}
+
+// Снимает с очередей клиентов, чей срок ожидания истёк, и отвечает им ST_TIMEOUT.
+void expireWaiters() {
+    Clock::time_point now = Clock::now();
+    while (!waitDeadlines.empty() && waitDeadlines.begin()->first <= now) {
+        int id = waitDeadlines.begin()->second;
+        waitDeadlines.erase(waitDeadlines.begin());
+
+        RecordSlot* r = findRecord(id);
+        if (!r || !r->waiters) continue;
+
+        WaitQueue& waiters = *r->waiters;
+        bool removedHead = false;
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            if (it->hasDeadline && it->deadline <= now) {
+                removedHead = removedHead || it == waiters.begin();
+
+                Response resp{};
+                resp.seq = it->seq;
+                resp.ok = false;
+                resp.status = ST_TIMEOUT;
+                cout << "Клиент " << it->pid
+                    << " не дождался доступа к записи " << id << endl;
+                cout.flush();
+                sendResponse(it->pid, resp);
+
+                it = waiters.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        if (waiters.empty()) contended.erase(id);
+
+        // За ушедшим писателем могли стоять читатели, которых уже можно пустить.
+        if (removedHead) grantWaiters(id);
+    }
+}
+
+void subscribe(const Request& req) {
+    int from = req.id;
+    int to = req.rangeEnd < req.id ? req.id : req.rangeEnd;
+
+    lock_guard<mutex> guard(subscribersMutex);
+    subscribers[req.clientPid].ranges.push_back(make_pair(from, to));
+
+    cout << "Клиент " << req.clientPid
+        << " подписался на записи " << from << ".." << to << endl;
+    cout.flush();
+}
+
+void unsubscribe(DWORD pid) {
+    lock_guard<mutex> guard(subscribersMutex);
+    if (subscribers.erase(pid)) {
+        cout << "Клиент " << pid << " отменил подписку" << endl;
+        cout.flush();
+    }
+}
+
+// Вызывается после каждого сохранённого изменения записи.
+void publishChange(int id) {
+    ChangeEvent ev{};
+    ev.id = id;
+    RecordSlot* r = findRecord(id);
+    ev.deleted = r == nullptr;
+    if (r) {
+        ev.version = r->version;
+        ev.data = r->data;
+    }
+    else {
+        ev.version = retiredVersions[id];
+    }
+
+    commitLsn++;
+    if (!standby) replication.publish(ev, commitLsn);
+
+    bool queued = false;
+    {
+        lock_guard<mutex> guard(subscribersMutex);
+        for (auto& p : subscribers) {
+            Subscriber& sub = p.second;
+
+            bool matches = false;
+            for (auto& r : sub.ranges) {
+                if (id >= r.first && id <= r.second) {
+                    matches = true;
+                    break;
+                }
+            }
+            if (!matches || sub.overflow) continue;
+
+            if (sub.pending.size() >= MAX_PENDING_EVENTS && !sub.pending.count(id)) {
+                sub.pending.clear();
+                sub.overflow = true;
+            }
+            else {
+                sub.pending[id] = ev;
+            }
+            queued = true;
+        }
+        if (queued) eventsPending = true;
+    }
+    if (queued) eventsReady.notify_one();
+}
+
+bool sendEvents(DWORD pid, const vector<ChangeEvent>& events, bool overflow) {
+    EventBatch batch;
+    batch.count = (uint32_t)events.size();
+    batch.overflow = overflow;
+    batch.epoch = serverEpoch;
+
+    ipc::Connection conn;
+    return ipc::connect(clientEventsPipeName(pid), conn)
+        && conn.sendAll(&batch, sizeof(batch))
+        && (events.empty() || conn.sendAll(events.data(), events.size() * sizeof(ChangeEvent)));
+}
+
+void notifyLoop() {
+    struct Delivery {
+        DWORD pid;
+        vector<ChangeEvent> events;
+        bool overflow;
+    };
+    vector<Delivery> deliveries;
+
+    while (true) {
+        deliveries.clear();
+        {
+            unique_lock<mutex> guard(subscribersMutex);
+            // Просыпается к пульсу того подписчика, которому он нужен раньше всех.
+            Clock::time_point wakeAt = Clock::now() + chrono::milliseconds(SUBSCRIPTION_HEARTBEAT_MS);
+            for (auto& p : subscribers) {
+                wakeAt = min(wakeAt, p.second.lastSent + chrono::milliseconds(SUBSCRIPTION_HEARTBEAT_MS));
+            }
+            eventsReady.wait_until(guard, wakeAt, [] { return eventsPending || notifierStop; });
+            if (notifierStop) return;
+
+            Clock::time_point now = Clock::now();
+            for (auto& p : subscribers) {
+                Subscriber& sub = p.second;
+                bool quiet = now - sub.lastSent >= chrono::milliseconds(SUBSCRIPTION_HEARTBEAT_MS);
+                if (sub.pending.empty() && !sub.overflow && !quiet) continue;
+
+                Delivery d;
+                d.pid = p.first;
+                d.overflow = sub.overflow;
+                for (auto& e : sub.pending) d.events.push_back(e.second);
+                deliveries.push_back(d);
+
+                sub.pending.clear();
+                sub.overflow = false;
+                sub.lastSent = now;
+            }
+            eventsPending = false;
+        }
+
+        for (auto& d : deliveries) {
+            if (sendEvents(d.pid, d.events, d.overflow)) continue;
+
+            // Канал уведомлений закрыт — клиент завершился или отписался.
+            cout << "Клиент " << d.pid << " недоступен, подписка удалена" << endl;
+            cout.flush();
+            lock_guard<mutex> guard(subscribersMutex);
+            subscribers.erase(d.pid);
+        }
+    }
+}
+
+// Ближайший момент, когда главному потоку нужно проснуться без запроса:
+// истечение срока ожидания блокировки, очередная контрольная точка или
+// проверка связи резервного с основным.
+bool nextWakeup(Clock::time_point& at) {
+    bool timed = false;
+    if (!waitDeadlines.empty()) {
+        at = waitDeadlines.begin()->first;
+        timed = true;
+    }
+    if (!dirty.empty() && (!timed || nextCheckpoint < at)) {
+        at = nextCheckpoint;
+        timed = true;
+    }
+    if (standby && replicationSink.isRunning()) {
+        Clock::time_point silent = replicationSink.lastHeard()
+            + chrono::milliseconds(REPLICA_SILENCE_MS);
+        Clock::time_point check = max(silent, nextReattach);
+        if (!timed || check < at) {
+            at = check;
+            timed = true;
+        }
+    }
+    return timed;
+}
+
+bool nextRequest(Request& req) {
+    Clock::time_point wakeAt;
+    bool timed = nextWakeup(wakeAt);
+
+    // Пришедшие изменения основного сервера тоже будят главный поток.
+    auto ready = [] { return !incoming.empty() || !replicated.empty(); };
+
+    unique_lock<mutex> guard(incomingMutex);
+    if (!ready()) {
+        if (!timed) {
+            incomingReady.wait(guard, ready);
+        }
+        else if (!incomingReady.wait_until(guard, wakeAt, ready)) {
+            return false;
+        }
+    }
+    return incoming.pop(req);
+}
+
+atomic<bool> acceptStop(false);
+
+// Отказ отправляется из потока приёма, минуя главный поток и его состояние
+// клиентов, поэтому перегруженный сервер отвечает на него сразу.
+void rejectRequest(const Request& req, Admission verdict) {
+    const char* reason = verdict == ADMIT_RATE_LIMITED ? "превышена частота запросов"
+        : verdict == ADMIT_SESSION_FULL ? "переполнена очередь клиента"
+        : "сервер перегружен";
+    cout << "Клиент " << req.clientPid << ": запрос отклонён (" << reason << ")" << endl;
+    cout.flush();
+
+    Response resp{};
+    resp.seq = req.seq;
+    resp.ok = false;
+    resp.status = ST_OVERLOADED;
+    resp.epoch = serverEpoch;
+    ipc::Connection conn;
+    if (ipc::connect(clientPipeName(req.clientPid), conn)) {
+        conn.sendAll(&resp, sizeof(resp));
+    }
+}
+
+// Подключения клиентов читает небольшой постоянный набор потоков. Место
+// под открытые подключения выделено заранее; когда оно занято, новое
+// подключение ждёт, пока какое-нибудь закроется. Поток чтения берёт
+// подключение из очереди, читает из него один запрос и возвращает его в
+// конец очереди, поэтому клиент, который держит подключение открытым, не
+// задерживает остальных. Пакетный клиент передаёт несколько запросов одним
+// подключением подряд; их порядок сохраняется, потому что подключение
+// в каждый момент читает только один поток.
+const size_t CONNECTION_READERS = 4;
+const size_t MAX_OPEN_CONNECTIONS = 64;
+// Столько поток чтения ждёт данных от подключения, прежде чем перейти
+// к следующему; подключение, молчащее дольше CONNECTION_IDLE_MS, закрывается.
+const unsigned CONNECTION_SLICE_MS = 10;
+const int CONNECTION_IDLE_MS = 5000;
+const size_t NO_CONNECTION = (size_t)-1;
+
+struct OpenConnection {
+    ipc::Connection conn;
+    Clock::time_point lastData;
+    size_t received;
+};
+
+mutex connectionsMutex;
+condition_variable connectionQueued;
+condition_variable connectionFreed;
+vector<OpenConnection> connections(MAX_OPEN_CONNECTIONS);
+RingBuffer<size_t> queuedConnections(MAX_OPEN_CONNECTIONS);
+vector<size_t> freeConnections;
+// Подключение, которое сейчас читает каждый поток, — чтобы прервать чтение
+// при остановке.
+vector<size_t> readingConnections(CONNECTION_READERS, NO_CONNECTION);
+vector<thread> readers;
+bool readersStop = false;
+
+// Читает из подключения не больше одного запроса; false — подключение
+// пора закрыть.
+bool readRequest(OpenConnection& c) {
+    if (!c.conn.waitReadable(CONNECTION_SLICE_MS)) {
+        return Clock::now() - c.lastData < chrono::milliseconds(CONNECTION_IDLE_MS);
+    }
+
+    Request req;
+    if (!c.conn.recvAll(&req, sizeof(req))) {
+        if (c.received == 0 && !acceptStop) {
+            cout << "Ошибка чтения запроса: " << lastError() << endl;
+            cout.flush();
+        }
+        return false;
+    }
+    c.received++;
+    c.lastData = Clock::now();
+
+    Admission verdict;
+    {
+        lock_guard<mutex> guard(incomingMutex);
+        verdict = incoming.push(req, Clock::now());
+    }
+    if (verdict != ADMIT_OK) {
+        rejectRequest(req, verdict);
+        return true;
+    }
+    incomingReady.notify_one();
+    return req.cmd != CMD_EXIT;
+}
+
+void readConnections(size_t reader) {
+    unique_lock<mutex> guard(connectionsMutex);
+    while (true) {
+        connectionQueued.wait(guard, [] { return readersStop || !queuedConnections.empty(); });
+        if (readersStop) return;
+
+        size_t index = queuedConnections.front();
+        queuedConnections.pop_front();
+        readingConnections[reader] = index;
+        guard.unlock();
+
+        bool keep = readRequest(connections[index]);
+
+        guard.lock();
+        readingConnections[reader] = NO_CONNECTION;
+        if (keep) {
+            queuedConnections.push_back(index);
+            connectionQueued.notify_one();
+        }
+        else {
+            connections[index].conn.close();
+            freeConnections.push_back(index);
+            connectionFreed.notify_one();
+        }
+    }
+}
+
+void startReaders() {
+    readersStop = false;
+    freeConnections.clear();
+    for (size_t i = MAX_OPEN_CONNECTIONS; i > 0; i--) {
+        freeConnections.push_back(i - 1);
+    }
+    for (size_t i = 0; i < CONNECTION_READERS; i++) {
+        readers.emplace_back(readConnections, i);
+    }
+}
+
+// При остановке сервера прерывает чтение подключений, которые клиенты
+// ещё держат открытыми.
+void stopReaders() {
+    {
+        lock_guard<mutex> guard(connectionsMutex);
+        readersStop = true;
+        for (size_t index : readingConnections) {
+            if (index != NO_CONNECTION) connections[index].conn.shutdown();
+        }
+    }
+    connectionQueued.notify_all();
+    connectionFreed.notify_all();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    readers.clear();
+    for (auto& c : connections) {
+        c.conn.close();
+    }
+}
+
+void acceptLoop(ipc::Listener* pipe) {
+    while (true) {
+        cout << "Ожидание подключения клиента..." << endl;
+        cout.flush();
+        ipc::Connection conn;
+        if (!pipe->accept(conn)) {
+            cout << "Ошибка подключения: " << lastError() << endl;
+            cout.flush();
+            sleepMs(10);
+            continue;
+        }
+        if (acceptStop) return;
+
+        cout << "Клиент подключен" << endl;
+        cout.flush();
+
+        unique_lock<mutex> guard(connectionsMutex);
+        connectionFreed.wait(guard,
+            [] { return acceptStop || readersStop || !freeConnections.empty(); });
+        if (acceptStop || readersStop) return;
+
+        size_t index = freeConnections.back();
+        freeConnections.pop_back();
+        OpenConnection& c = connections[index];
+        c.conn = move(conn);
+        c.lastData = Clock::now();
+        c.received = 0;
+        queuedConnections.push_back(index);
+        connectionQueued.notify_one();
+    }
+}
+
+// Поток приёма заблокирован в accept; его будит пустое подключение.
+void stopAcceptor(const string& name, thread& acceptor) {
+    if (!acceptor.joinable()) return;
+
+    acceptStop = true;
+    {
+        // Поток приёма мог ждать места под подключение.
+        lock_guard<mutex> guard(connectionsMutex);
+    }
+    connectionFreed.notify_all();
+    ipc::Connection wake;
+    ipc::connect(name, wake);
+    wake.close();
+    acceptor.join();
+}
+
+// Снимает запись из памяти, файла и разделяемой памяти. Ожидающим в очереди
+// сообщается, что записи больше нет; удерживаемые на неё блокировки
+// забываются, чтобы их завершение не задело запись, добавленную позже
+// с тем же ID.
+void removeRecord(int id, uint32_t version) {
+    RecordSlot* r = findRecord(id);
+
+    if (r->waiters) {
+        for (auto& w : *r->waiters) {
+            Response resp{};
+            resp.seq = w.seq;
+            resp.ok = false;
+            resp.status = ST_NOT_FOUND;
+            sendResponse(w.pid, resp);
+        }
+        waitQueuePool.release(r->waiters);
+        contended.erase(id);
+    }
+    for (auto& p : sessions) {
+        dropHeld(p.first, id);
+    }
+
+    retiredVersions[id] = version;
+    releaseSlot(r->fileSlot);
+    records.erase(id);
+    recordPool.release(r);
+
+    sharedStore.remove(id, version);
+    publishChange(id);
+}
+
+// Удалить запись можно, если её никто не читает и не изменяет — кроме
+// самого удаляющего клиента, который может держать её блокировку записи.
+bool deleteRecord(DWORD pid, int id) {
+    RecordSlot* r = findRecord(id);
+
+    bool ownsWrite = heldMode(pid, id) == CMD_WRITE_REQUEST;
+    if (r->lockWord > 0 || (r->lockWord == LOCK_WRITER && !ownsWrite)) {
+        return false;
+    }
+
+    if (ownsWrite) {
+        endWrite(id);
+    }
+    removeRecord(id, r->version + 1);
+    return true;
+}
+
+// Применяет изменение основного сервера на резервном. Версии берутся
+// с основного, поэтому клиентский кэш остаётся верным при переходе между ними.
+void applyChange(const ChangeEvent& ev) {
+    RecordSlot* r = findRecord(ev.id);
+    if (ev.deleted) {
+        if (r) removeRecord(ev.id, ev.version);
+        else retiredVersions[ev.id] = ev.version;
+        return;
+    }
+
+    if (r) {
+        r->data = ev.data;
+        r->version = ev.version;
+        markDirty(r->fileSlot);
+    }
+    else {
+        retiredVersions.erase(ev.id);
+        records[ev.id] = recordPool.acquire(ev.data, ev.version, allocateSlot(ev.id));
+    }
+    publishShared(ev.data, ev.version);
+    publishChange(ev.id);
+}
+
+void applyReplicated() {
+    while (true) {
+        ReplicatedBatch batch;
+        {
+            lock_guard<mutex> guard(incomingMutex);
+            if (replicated.empty()) return;
+            batch = replicated.front();
+            replicated.pop_front();
+        }
+
+        // Полное состояние: записей, которых в нём нет, на основном уже нет.
+        if (batch.reset) {
+            set<int> present;
+            for (auto& ev : batch.events) {
+                if (!ev.deleted) present.insert(ev.id);
+            }
+            vector<int> gone;
+            for (auto& p : records) {
+                if (!present.count(p.first)) gone.push_back(p.first);
+            }
+            for (int id : gone) {
+                removeRecord(id, records[id]->version + 1);
+            }
+        }
+
+        for (auto& ev : batch.events) {
+            applyChange(ev);
+        }
+        commitLsn = batch.lsn;
+
+        cout << "Применены изменения основного сервера до LSN " << commitLsn
+            << " (записей: " << batch.events.size() << ")" << endl;
+        cout.flush();
+    }
+}
+
+bool attachToPrimary() {
+    Request req{};
+    req.cmd = CMD_REPLICATE;
+    req.clientPid = currentProcessId();
+    Response resp;
+    if (!sendRequest(req, resp, primaryName) || !resp.ok) {
+        cout << "Основной сервер " << primaryName << " не принял резервный" << endl;
+        cout.flush();
+        return false;
+    }
+
+    cout << "Резервный сервер подключён к основному " << primaryName << endl;
+    cout.flush();
+    return true;
+}
+
+bool startStandby() {
+    DWORD pid = currentProcessId();
+    bool started = replicationSink.start(pid,
+        [](const vector<ChangeEvent>& events, bool reset, uint64_t lsn) {
+            {
+                lock_guard<mutex> guard(incomingMutex);
+                replicated.push_back(ReplicatedBatch{ events, reset, lsn });
+            }
+            incomingReady.notify_one();
+        });
+    if (!started) {
+        cout << "Ошибка создания канала репликации: " << lastError() << endl;
+        cout.flush();
+        return false;
+    }
+
+    nextReattach = Clock::now() + chrono::milliseconds(REPLICA_SILENCE_MS);
+    if (!attachToPrimary()) {
+        replicationSink.stop();
+        return false;
+    }
+    return true;
+}
+
+// Повторные подключения к основному идут в отдельном потоке: основной,
+// который завис, а не завершился, принимает подключение, но не отвечает,
+// и главный поток, а с ним и CMD_PROMOTE, остановился бы.
+mutex attachMutex;
+condition_variable attachWake;
+bool attachRequested = false;
+bool attachBusy = false;
+bool attachStop = false;
+thread attacher;
+
+void attachLoop() {
+    unique_lock<mutex> guard(attachMutex);
+    while (true) {
+        attachWake.wait_for(guard, chrono::milliseconds(100),
+            [] { return attachStop || attachRequested; });
+        if (attachStop) return;
+        if (!attachRequested) continue;
+
+        attachRequested = false;
+        attachBusy = true;
+        guard.unlock();
+        attachToPrimary();
+        guard.lock();
+        attachBusy = false;
+        attachWake.notify_all();
+    }
+}
+
+void startAttacher() {
+    attachStop = false;
+    attacher = thread(attachLoop);
+}
+
+void requestAttach() {
+    lock_guard<mutex> guard(attachMutex);
+    if (attachBusy) return;
+    attachRequested = true;
+    attachWake.notify_all();
+}
+
+// Поток, ждущий ответа зависшего основного, будит пустое подключение
+// к каналу ответа резервного.
+void stopAttacher() {
+    if (!attacher.joinable()) return;
+
+    unique_lock<mutex> guard(attachMutex);
+    attachStop = true;
+    attachWake.notify_all();
+    while (attachBusy) {
+        guard.unlock();
+        ipc::Connection wake;
+        ipc::connect(clientPipeName(currentProcessId()), wake);
+        wake.close();
+        guard.lock();
+        attachWake.wait_for(guard, chrono::milliseconds(50), [] { return !attachBusy; });
+    }
+    guard.unlock();
+    attacher.join();
+}
+
+// Резервный, которого основной отключил (или не знает после перезапуска),
+// перестаёт получать даже пустые пачки. Тогда он подключается заново
+// и получает полное состояние; до этого он отвечает устаревшими данными.
+void checkPrimary() {
+    if (!standby || !replicationSink.isRunning()) return;
+
+    Clock::time_point now = Clock::now();
+    if (now - replicationSink.lastHeard() < chrono::milliseconds(REPLICA_SILENCE_MS)
+        || now < nextReattach) {
+        return;
+    }
+
+    cout << "От основного сервера " << primaryName << " нет изменений дольше "
+        << REPLICA_SILENCE_MS << " мс, данные могут быть устаревшими" << endl;
+    cout.flush();
+    nextReattach = now + chrono::milliseconds(REPLICA_SILENCE_MS);
+    requestAttach();
+}
+
+// Резервный сервер становится основным: занимает канал прежнего основного,
+// дописывает уже полученные изменения, перестаёт принимать поток от него,
+// открывает разделяемую память и начинает принимать запросы под его именем.
+// Пока канал не занят, прежний основной может быть жив: тогда резервный
+// остаётся резервным, иначе основных, принимающих изменения, стало бы два.
+bool promote(thread& primaryAcceptor) {
+    if (!primaryPipe.listen(primaryName)) {
+        cout << "Не удалось занять канал " << primaryName << ": " << lastError() << endl;
+        cout.flush();
+        return false;
+    }
+
+    stopAttacher();
+    replicationSink.stop();
+    applyReplicated();
+    standby = false;
+
+    // Клиенты прежнего основного ищут записи в области под его именем.
+    if (sharedStore.create(sharedStoreName(primaryName), serverEpoch)) {
+        for (auto& p : records) {
+            publishShared(p.second->data, p.second->version);
+        }
+    }
+    else {
+        cout << "Разделяемая память недоступна, быстрое чтение отключено\n";
+        cout.flush();
+    }
+    replication.start();
+    primaryAcceptor = thread(acceptLoop, &primaryPipe);
+
+    cout << "Сервер повышен до основного (LSN " << commitLsn << ")" << endl;
+    cout.flush();
+    return true;
+}
+
+bool isWriteCommand(CommandType cmd) {
+    return cmd == CMD_WRITE_REQUEST || cmd == CMD_WRITE_SUBMIT
+        || cmd == CMD_INSERT || cmd == CMD_DELETE || cmd == CMD_REPLICATE;
+}
+
+void processRequest(const Request& req) {
+    try {
+        Response resp{};
+        resp.seq = req.seq;
+        int id = req.id;
+
+        if (standby && isWriteCommand(req.cmd)) {
+            resp.ok = false;
+            resp.status = ST_READ_ONLY;
+            cout << "Клиент " << req.clientPid
+                << " запросил изменение у резервного сервера" << endl;
+            cout.flush();
+            sendResponse(req.clientPid, resp);
+            return;
+        }
+
+        switch (req.cmd) {
+        case CMD_READ:
+        case CMD_WRITE_REQUEST: {
+            if (!findRecord(id)) {
+                resp.ok = false;
+                resp.status = ST_NOT_FOUND;
+                sendResponse(req.clientPid, resp);
+                break;
+            }
+
+            bool granted = req.cmd == CMD_READ ? beginRead(id) : beginWrite(id);
+            if (granted) {
+                grantAccess(req.clientPid, req.cmd, id, req.seq);
+            }
+            else if (req.waitMs != 0) {
+                enqueueWaiter(req);
+            }
+            else {
+                resp.ok = false;
+                resp.status = ST_BUSY;
+                if (req.cmd == CMD_READ) {
+                    cout << "Клиент " << req.clientPid
+                        << " не смог прочитать запись " << id << " (занята писателем)" << endl;
+                }
+                else {
+                    cout << "Клиент " << req.clientPid
+                        << " не смог получить доступ для записи " << id << " (занято)" << endl;
+                }
+                cout.flush();
+                sendResponse(req.clientPid, resp);
+            }
+            break;
+        }
+
+        case CMD_WRITE_SUBMIT: {
+            // Изменение принимается только от держателя блокировки записи:
+            // запросы пакетного клиента идут подряд, и отказ в блокировке
+            // не должен превращаться в запись без неё.
+            RecordSlot* r = findRecord(id);
+            if (r && heldMode(req.clientPid, id) != CMD_WRITE_REQUEST) {
+                resp.ok = false;
+                resp.status = ST_BUSY;
+            }
+            else if (r) {
+                r->data = req.data;
+                r->data.num = id;
+                r->version++;
+                markDirty(r->fileSlot);
+                publishShared(r->data, r->version);
+                publishChange(id);
+                resp.ok = true;
+                resp.version = r->version;
+                cout << "Клиент " << req.clientPid
+                    << " сохранил изменения записи " << id << endl;
+                cout.flush();
+            }
+            else {
+                resp.ok = false;
+                resp.status = ST_NOT_FOUND;
+            }
+            sendResponse(req.clientPid, resp);
+            break;
+        }
+
+        case CMD_FINISH_ACCESS: {
+            int cmd = heldMode(req.clientPid, id);
+            if (cmd != -1) {
+                if (cmd == CMD_READ) {
+                    endRead(id);
+                    cout << "Клиент " << req.clientPid
+                        << " завершил чтение записи " << id << endl;
+                    cout.flush();
+                }
+                else if (cmd == CMD_WRITE_REQUEST) {
+                    endWrite(id);
+                    cout << "Клиент " << req.clientPid
+                        << " завершил запись в запись " << id << endl;
+                    cout.flush();
+                }
+                dropHeld(req.clientPid, id);
+                grantWaiters(id);
+            }
+            resp.ok = true;
+            sendResponse(req.clientPid, resp);
+            break;
+        }
+
+        case CMD_SUBSCRIBE:
+            subscribe(req);
+            resp.ok = true;
+            sendResponse(req.clientPid, resp);
+            break;
+
+        case CMD_INSERT:
+            if (id == TOMBSTONE_ID || findRecord(id)) {
+                resp.ok = false;
+                resp.status = ST_EXISTS;
+            }
+            else {
+                employee e = req.data;
+                e.num = id;
+                uint32_t version = 1;
+                auto retired = retiredVersions.find(id);
+                if (retired != retiredVersions.end()) {
+                    version = retired->second + 1;
+                    retiredVersions.erase(retired);
+                }
+                records[id] = recordPool.acquire(e, version, allocateSlot(id));
+                publishShared(e, version);
+                publishChange(id);
+
+                resp.ok = true;
+                resp.data = e;
+                resp.version = version;
+                cout << "Клиент " << req.clientPid
+                    << " добавил запись " << id << endl;
+                cout.flush();
+            }
+            sendResponse(req.clientPid, resp);
+            break;
+
+        case CMD_DELETE:
+            if (!findRecord(id)) {
+                resp.ok = false;
+                resp.status = ST_NOT_FOUND;
+            }
+            else if (!deleteRecord(req.clientPid, id)) {
+                resp.ok = false;
+                resp.status = ST_BUSY;
+                cout << "Клиент " << req.clientPid
+                    << " не смог удалить запись " << id << " (занята)" << endl;
+                cout.flush();
+            }
+            else {
+                resp.ok = true;
+                resp.version = retiredVersions[id];
+                cout << "Клиент " << req.clientPid
+                    << " удалил запись " << id << endl;
+                cout.flush();
+            }
+            sendResponse(req.clientPid, resp);
+            break;
+
+        case CMD_VALIDATE: {
+            // Проверка кэша клиента: без блокировки записи и без CMD_FINISH_ACCESS.
+            RecordSlot* r = findRecord(id);
+            if (!r) {
+                resp.ok = false;
+                resp.status = ST_NOT_FOUND;
+            }
+            else {
+                resp.ok = true;
+                resp.version = r->version;
+                if (r->version == req.version && req.epoch == serverEpoch) {
+                    resp.status = ST_NOT_MODIFIED;
+                }
+                else {
+                    resp.data = r->data;
+                }
+            }
+            sendResponse(req.clientPid, resp);
+            break;
+        }
+
+        case CMD_UNSUBSCRIBE:
+            unsubscribe(req.clientPid);
+            resp.ok = true;
+            sendResponse(req.clientPid, resp);
+            break;
+
+        case CMD_REPLICATE: {
+            vector<ChangeEvent> snapshot;
+            snapshot.reserve(records.size());
+            for (auto& p : records) {
+                ChangeEvent ev{};
+                ev.id = p.first;
+                ev.version = p.second->version;
+                ev.data = p.second->data;
+                snapshot.push_back(ev);
+            }
+            replication.addReplica(req.clientPid, snapshot, commitLsn);
+            resp.ok = true;
+            cout << "Подключён резервный сервер " << req.clientPid
+                << " (записей: " << snapshot.size() << ", LSN " << commitLsn << ")" << endl;
+            cout.flush();
+            sendResponse(req.clientPid, resp);
+            break;
+        }
+
+        case CMD_LOCK_DUMP:
+            sendLockDump(req);
+            break;
+
+        default:
+            break;
+        }
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при обработке запроса: " << e.what() << endl;
+        cout.flush();
+    }
+}
+
+void releaseState() {
+    for (auto& pair : records) {
+        if (pair.second->waiters) waitQueuePool.release(pair.second->waiters);
+        recordPool.release(pair.second);
+    }
+    records.clear();
+    contended.clear();
+    for (auto& pair : sessions) {
+        sessionPool.release(pair.second);
+    }
+    sessions.clear();
+}
+
+// Спрашивает имя файла и записи и создаёт новый файл записей.
+bool createFile() {
+    cout << "Введите имя файла: ";
+    cout.flush();
+    cin >> filename;
+
+    // Резервный сервер получает записи от основного.
+    int n = 0;
+    if (!standby) {
+        cout << "Количество сотрудников: ";
+        cout.flush();
+        cin >> n;
+    }
+
+    vector<employee> initial;
+    for (int i = 0; i < n; i++) {
+        employee e;
+        cout << "\nСотрудник " << (i + 1) << ":\n";
+        cout.flush();
+        cout << "  ID: ";
+        cout.flush();
+        cin >> e.num;
+        cout << "  Имя (max 10 символов): ";
+        cout.flush();
+        cin >> e.name;
+        cout << "  Часы: ";
+        cout.flush();
+        cin >> e.hours;
+        initial.push_back(e);
+    }
+
+    if (!writeRecordFile(filename, initial)) {
+        cout << "Ошибка создания файла!\n";
+        cout.flush();
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    thread acceptor;
+    thread primaryAcceptor;
+    thread notifier;
+    try {
+        setlocale(LC_ALL, "rus");
+
+        // --convert <старый> <новый>: перевести сырой файл записей в формат
+        // версии 2 и выйти.
+        if (argc == 4 && string(argv[1]) == "--convert") {
+            if (!convertRecordFile(argv[2], argv[3])) {
+                cout << "Не удалось перевести файл " << argv[2] << endl;
+                return 1;
+            }
+            cout << "Файл " << argv[2] << " переведён в формат версии 2: " << argv[3] << endl;
+            return 0;
+        }
+
+        // --name <канал>: принимать запросы под другим именем;
+        // --replica-of <канал>: запуститься резервным сервером для основного;
+        // --rate <запросов/с>, --burst <запросов>: ограничения одного клиента,
+        // например для пакетных клиентов (Client --batch);
+        // --load <файл>: открыть существующий файл записей вместо создания
+        // нового (файл старого формата переводится в версию 2).
+        AdmissionLimits limits;
+        string loadName;
+        for (int i = 1; i + 1 < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--name") {
+                serverName = argv[++i];
+            }
+            else if (arg == "--replica-of") {
+                primaryName = argv[++i];
+                standby = true;
+            }
+            else if (arg == "--rate") {
+                limits.ratePerSecond = stod(argv[++i]);
+            }
+            else if (arg == "--burst") {
+                limits.burst = stod(argv[++i]);
+            }
+            else if (arg == "--load") {
+                loadName = argv[++i];
+            }
+        }
+        incoming.setLimits(limits);
+
+        serverEpoch = (uint32_t)chrono::system_clock::now().time_since_epoch().count()
+            ^ (currentProcessId() << 16);
+        if (serverEpoch == 0) serverEpoch = 1;
+
+        // Резервный под именем основного принимал бы собственный CMD_REPLICATE.
+        if (standby && serverName == primaryName) {
+            cout << "Резервному серверу нужно своё имя канала: --name <канал>" << endl;
+            return 1;
+        }
+
+        cout << (standby ? " Резервный сервер " : " Сервер ") << endl;
+        cout.flush();
+
+        if (!loadName.empty()) {
+            filename = loadName;
+        }
+        else if (!createFile()) {
+            return 1;
+        }
+
+        // Разделяемую память держит основной сервер, по области на имя канала.
+        if (!standby && !sharedStore.create(sharedStoreName(serverName), serverEpoch)) {
+            cout << "Разделяемая память недоступна, быстрое чтение отключено\n";
+            cout.flush();
+        }
+
+        if (!loadFile()) return 1;
+        printFile();
+
+        if (!standby) {
+            cout << "\nВведите количество клиентов: ";
+            cout.flush();
+            int clientCount;
+            cin >> clientCount;
+            cout << "Ожидаю до " << clientCount << " клиентов...\n";
+            cout.flush();
+        }
+
+        cout << "\nСервер запущен. Ожидаю клиентов...\n";
+        cout.flush();
+
+        if (!serverPipe.listen(serverName)) {
+            cout << "Ошибка создания канала: " << lastError() << endl;
+            cout.flush();
+            return 1;
+        }
+
+        checkpointer.start(filename, slotIds.size());
+        if (standby) {
+            if (!startStandby()) {
+                checkpointer.stop();
+                return 1;
+            }
+            startAttacher();
+        }
+        else {
+            replication.start();
+        }
+        startReaders();
+        acceptor = thread(acceptLoop, &serverPipe);
+        notifier = thread(notifyLoop);
+
+        while (true) {
+            applyReplicated();
+            // Сроки ожидания проверяются на каждом шаге: при непрерывном
+            // потоке запросов nextRequest не доживает до срока.
+            expireWaiters();
+            pruneSessions();
+            checkPrimary();
+
+            Request req;
+            if (!nextRequest(req)) {
+                maybeCheckpoint();
+                continue;
+            }
+
+            if (req.cmd == CMD_PROMOTE) {
+                Response resp{};
+                resp.seq = req.seq;
+                resp.ok = !standby || promote(primaryAcceptor);
+                sendResponse(req.clientPid, resp);
+                maybeCheckpoint();
+                continue;
+            }
+
+            if (req.cmd == CMD_EXIT) {
+                cout << "Получена команда завершения работы" << endl;
+                cout.flush();
+                Response resp{};
+                resp.seq = req.seq;
+                resp.ok = true;
+                sendResponse(req.clientPid, resp);
+                break;
+            }
+
+            processRequest(req);
+            maybeCheckpoint();
+        }
+        stopAcceptor(serverName, acceptor);
+        stopAcceptor(primaryName, primaryAcceptor);
+        stopReaders();
+        stopAttacher();
+        serverPipe.close();
+        primaryPipe.close();
+        replicationSink.stop();
+        replication.stop();
+
+        {
+            lock_guard<mutex> guard(subscribersMutex);
+            notifierStop = true;
+        }
+        eventsReady.notify_one();
+        notifier.join();
+
+        for (auto& pair : records) {
+            if (!pair.second->waiters) continue;
+            for (auto& w : *pair.second->waiters) {
+                Response resp{};
+                resp.seq = w.seq;
+                resp.ok = false;
+                resp.status = ST_BUSY;
+                sendResponse(w.pid, resp);
+            }
+            pair.second->waiters->clear();
+        }
+        contended.clear();
+        sharedStore.close();
+
+        flushDirty();
+        checkpointer.stop();
+        cout << "\nФинальное состояние файла:\n";
+        cout.flush();
+        printFile();
+
+        releaseState();
+
+        cout << "\nСервер завершил работу.\n";
+        cout.flush();
+        return 0;
+    }
+    catch (const exception& e) {
+        cout << "Критическая ошибка в работе сервера: " << e.what() << endl;
+        cout.flush();
+
+        if (acceptor.joinable()) {
+            acceptor.detach();
+        }
+        if (primaryAcceptor.joinable()) {
+            primaryAcceptor.detach();
+        }
+        if (notifier.joinable()) {
+            notifier.detach();
+        }
+        stopReaders();
+        stopAttacher();
+
+        releaseState();
+
+        serverPipe.close();
+        primaryPipe.close();
+
+        return 1;
+    }
 }
\ No newline at end of file
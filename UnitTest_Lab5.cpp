@@ -1,286 +1,1558 @@
-﻿#include "pch.h"
-#include "CppUnitTest.h"
-#include <map>
-#include <string>
-#include "employee.h"
-#include <fstream>
-
-class MockServerLogic {
-private:
-    std::map<int, employee> database;
-    std::map<int, bool> recordLocks;
-    std::map<DWORD, int> clientOperations;
-
-public:
-    MockServerLogic() = default;
-
-    void loadTestData() {
-        employee emp1{ 1, "John", 40.5 };
-        employee emp2{ 2, "Alice", 35.0 };
-        employee emp3{ 3, "Bob", 42.0 };
-
-        database[1] = emp1;
-        database[2] = emp2;
-        database[3] = emp3;
-    }
-
-    bool readRecord(int id, employee& result) {
-        if (recordLocks[id]) return false; 
-
-        auto it = database.find(id);
-        if (it != database.end()) {
-            result = it->second;
-            recordLocks[id] = true; 
-            return true;
-        }
-        return false;
-    }
-
-    bool writeRecord(int id, const employee& emp) {
-        if (recordLocks[id]) return false; 
-
-        recordLocks[id] = true;
-        database[id] = emp;
-        return true;
-    }
-
-    void releaseLock(int id) {
-        recordLocks[id] = false;
-    }
-
-    bool recordExists(int id) const {
-        return database.find(id) != database.end();
-    }
-
-    size_t getRecordCount() const {
-        return database.size();
-    }
-};
-
-using namespace Microsoft::VisualStudio::CppUnitTestFramework;
-
-namespace UnitTestLab5
-{
-    TEST_CLASS(EmployeeTests)
-    {
-    public:
-
-        TEST_METHOD(TestEmployeeSize)
-        {
-            size_t minSize = sizeof(int) + 10 * sizeof(char) + sizeof(double);
-            size_t actualSize = sizeof(employee);
-
-            Assert::IsTrue(actualSize >= minSize,
-                L"Размер структуры меньше ожидаемого минимального");
-
-            Assert::IsTrue(actualSize <= 64,
-                L"Размер структуры слишком большой");   
-        }
-
-        TEST_METHOD(TestEmployeeInitialization)
-        {
-            employee emp{};
-            emp.num = 1;
-            strcpy_s(emp.name, "John");
-            emp.hours = 40.5;
-
-            Assert::AreEqual(1, emp.num);
-            Assert::AreEqual("John", emp.name);
-            Assert::AreEqual(40.5, emp.hours);
-        }
-
-        TEST_METHOD(TestRequestResponseSizes)
-        {
-            Assert::IsTrue(sizeof(Request) > 0);
-            Assert::IsTrue(sizeof(Response) > 0);
-        }
-    };
-    TEST_CLASS(FileIOTests)
-    {
-    public:
-
-        TEST_METHOD(TestEmployeeBinaryWriteRead)
-        {
-            const char* testFileName = "test_employee.bin";
-
-            {
-                employee emp{ 1, "TestUser", 45.5 };
-                std::ofstream file(testFileName, std::ios::binary);
-                Assert::IsTrue(file.is_open());
-
-                file.write(reinterpret_cast<const char*>(&emp), sizeof(employee));
-                file.close();
-            }
-
-            {
-                employee readEmp{};
-                std::ifstream file(testFileName, std::ios::binary);
-                Assert::IsTrue(file.is_open());
-
-                file.read(reinterpret_cast<char*>(&readEmp), sizeof(employee));
-                file.close();
-
-                Assert::AreEqual(1, readEmp.num);
-                Assert::AreEqual("TestUser", readEmp.name);
-                Assert::AreEqual(45.5, readEmp.hours);
-            }
-        }
-
-        TEST_METHOD(TestMultipleEmployeesWriteRead)
-        {
-            const char* testFileName = "test_employees.bin";
-            const int numEmployees = 3;
-
-            {
-                std::ofstream file(testFileName, std::ios::binary);
-                Assert::IsTrue(file.is_open());
-
-                employee employees[numEmployees] = {
-                    {1, "First", 10.0},
-                    {2, "Second", 20.0},
-                    {3, "Third", 30.0}
-                };
-
-                for (int i = 0; i < numEmployees; i++) {
-                    file.write(reinterpret_cast<const char*>(&employees[i]),
-                        sizeof(employee));
-                }
-                file.close();
-            }
-
-            {
-                std::ifstream file(testFileName, std::ios::binary);
-                Assert::IsTrue(file.is_open());
-
-                for (int i = 0; i < numEmployees; i++) {
-                    employee readEmp{};
-                    file.read(reinterpret_cast<char*>(&readEmp), sizeof(employee));
-
-                    Assert::AreEqual(i + 1, readEmp.num);
-                    Assert::AreEqual(readEmp.hours, (i + 1) * 10.0);
-                }
-
-                file.close();
-            }
-        }
-
-        TEST_METHOD(TestFileOpenFailure)
-        {
-            std::ifstream file("nonexistent_file_12345.bin", std::ios::binary);
-            Assert::IsFalse(file.is_open());
-        }
-    };
-    TEST_CLASS(IntegrationTests)
-    {
-    public:
-
-        TEST_METHOD(TestCommandTypesValues)
-        {
-            Assert::AreEqual(0, (int)CMD_READ);
-            Assert::AreEqual(1, (int)CMD_WRITE_REQUEST);
-            Assert::AreEqual(2, (int)CMD_WRITE_SUBMIT);
-            Assert::AreEqual(3, (int)CMD_FINISH_ACCESS);
-            Assert::AreEqual(4, (int)CMD_EXIT);
-        }
-
-        TEST_METHOD(TestResponseStructure)
-        {
-            Response resp{};
-            resp.ok = true;
-            resp.data.num = 100;
-            strcpy_s(resp.data.name, "Test");
-            resp.data.hours = 50.5;
-
-            Assert::IsTrue(resp.ok);
-            Assert::AreEqual(100, resp.data.num);
-            Assert::AreEqual("Test", resp.data.name);
-            Assert::AreEqual(50.5, resp.data.hours);
-        }
-
-        TEST_METHOD(TestRequestStructure)
-        {
-            Request req{};
-            req.cmd = CMD_READ;
-            req.id = 42;
-            req.clientPid = 12345;
-            req.data.num = 1;
-            strcpy_s(req.data.name, "ReqData");
-            req.data.hours = 25.0;
-
-            Assert::AreEqual((int)CMD_READ, (int)req.cmd);
-            Assert::AreEqual(42, req.id);
-            Assert::AreEqual((DWORD)12345, req.clientPid);
-            Assert::AreEqual(1, req.data.num);
-        }
-    };
-    TEST_CLASS(ServerLogicTests)
-    {
-    public:
-
-        TEST_METHOD(TestDatabaseOperations)
-        {
-            MockServerLogic logic;
-            logic.loadTestData();
-
-            Assert::AreEqual((size_t)3, logic.getRecordCount());
-
-            Assert::IsTrue(logic.recordExists(1));
-            Assert::IsFalse(logic.recordExists(999));
-        }
-
-        TEST_METHOD(TestReadRecordSuccess)
-        {
-            MockServerLogic logic;
-            logic.loadTestData();
-
-            employee result{};
-            bool success = logic.readRecord(1, result);
-
-            Assert::IsTrue(success);
-            Assert::AreEqual(1, result.num);
-            Assert::AreEqual("John", result.name);
-            Assert::AreEqual(40.5, result.hours);
-        }
-
-        TEST_METHOD(TestReadRecordNotFound)
-        {
-            MockServerLogic logic;
-            logic.loadTestData();
-
-            employee result{};
-            bool success = logic.readRecord(999, result);
-
-            Assert::IsFalse(success);
-        }
-
-        TEST_METHOD(TestWriteRecordSuccess)
-        {
-            MockServerLogic logic;
-            logic.loadTestData();
-
-            employee newEmp{ 4, "Charlie", 38.0 };
-            bool success = logic.writeRecord(4, newEmp);
-
-            Assert::IsTrue(success);
-            Assert::IsTrue(logic.recordExists(4));
-        }
-
-        TEST_METHOD(TestConcurrentAccessPrevention)
-        {
-            MockServerLogic logic;
-            logic.loadTestData();
-
-            employee result1{};
-            bool success1 = logic.readRecord(1, result1);
-            Assert::IsTrue(success1);
-
-            employee result2{};
-            bool success2 = logic.readRecord(1, result2);
-            Assert::IsFalse(success2);
-
-            logic.releaseLock(1);
-            bool success3 = logic.readRecord(1, result2);
-            Assert::IsTrue(success3);
-        }
-    };
-}
+﻿#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "admission.h"
+#include "batch.h"
+#include "client_api.h"
+#include "employee.h"
+#include "read_cache.h"
+#include "record_format.h"
+#include "replication.h"
+#include "event_listener.h"
+#include "lock_report.h"
+#include "object_pool.h"
+#include "ring_buffer.h"
+#include "shared_store.h"
+#include "snapshot.h"
+#include <fstream>
+
+class MockServerLogic {
+private:
+    std::map<int, employee> database;
+    std::map<int, bool> recordLocks;
+    std::map<DWORD, int> clientOperations;
+
+public:
+    MockServerLogic() = default;
+
+    void loadTestData() {
+        employee emp1{ 1, "John", 40.5 };
+        employee emp2{ 2, "Alice", 35.0 };
+        employee emp3{ 3, "Bob", 42.0 };
+
+        database[1] = emp1;
+        database[2] = emp2;
+        database[3] = emp3;
+    }
+
+    bool readRecord(int id, employee& result) {
+        if (recordLocks[id]) return false; 
+
+        auto it = database.find(id);
+        if (it != database.end()) {
+            result = it->second;
+            recordLocks[id] = true; 
+            return true;
+        }
+        return false;
+    }
+
+    bool writeRecord(int id, const employee& emp) {
+        if (recordLocks[id]) return false; 
+
+        recordLocks[id] = true;
+        database[id] = emp;
+        return true;
+    }
+
+    void releaseLock(int id) {
+        recordLocks[id] = false;
+    }
+
+    bool recordExists(int id) const {
+        return database.find(id) != database.end();
+    }
+
+    size_t getRecordCount() const {
+        return database.size();
+    }
+};
+
+TEST(EmployeeTests, TestEmployeeSize)
+{
+    size_t minSize = sizeof(int) + 10 * sizeof(char) + sizeof(double);
+    size_t actualSize = sizeof(employee);
+
+    EXPECT_TRUE(actualSize >= minSize)
+        << "Размер структуры меньше ожидаемого минимального";
+
+    EXPECT_TRUE(actualSize <= 64)
+        << "Размер структуры слишком большой";
+}
+
+TEST(EmployeeTests, TestEmployeeInitialization)
+{
+    employee emp{};
+    emp.num = 1;
+    strncpy(emp.name, "John", sizeof(emp.name) - 1);
+    emp.hours = 40.5;
+
+    EXPECT_EQ(1, emp.num);
+    EXPECT_STREQ("John", emp.name);
+    EXPECT_DOUBLE_EQ(40.5, emp.hours);
+}
+
+TEST(EmployeeTests, TestRequestResponseSizes)
+{
+    EXPECT_TRUE(sizeof(Request) > 0);
+    EXPECT_TRUE(sizeof(Response) > 0);
+}
+
+TEST(FileIOTests, TestEmployeeBinaryWriteRead)
+{
+    const char* testFileName = "test_employee.bin";
+
+    {
+        employee emp{ 1, "TestUser", 45.5 };
+        std::ofstream file(testFileName, std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+
+        file.write(reinterpret_cast<const char*>(&emp), sizeof(employee));
+        file.close();
+    }
+
+    {
+        employee readEmp{};
+        std::ifstream file(testFileName, std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+
+        file.read(reinterpret_cast<char*>(&readEmp), sizeof(employee));
+        file.close();
+
+        EXPECT_EQ(1, readEmp.num);
+        EXPECT_STREQ("TestUser", readEmp.name);
+        EXPECT_DOUBLE_EQ(45.5, readEmp.hours);
+    }
+}
+
+TEST(FileIOTests, TestMultipleEmployeesWriteRead)
+{
+    const char* testFileName = "test_employees.bin";
+    const int numEmployees = 3;
+
+    {
+        std::ofstream file(testFileName, std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+
+        employee employees[numEmployees] = {
+            {1, "First", 10.0},
+            {2, "Second", 20.0},
+            {3, "Third", 30.0}
+        };
+
+        for (int i = 0; i < numEmployees; i++) {
+            file.write(reinterpret_cast<const char*>(&employees[i]),
+                sizeof(employee));
+        }
+        file.close();
+    }
+
+    {
+        std::ifstream file(testFileName, std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+
+        for (int i = 0; i < numEmployees; i++) {
+            employee readEmp{};
+            file.read(reinterpret_cast<char*>(&readEmp), sizeof(employee));
+
+            EXPECT_EQ(i + 1, readEmp.num);
+            EXPECT_DOUBLE_EQ(readEmp.hours, (i + 1) * 10.0);
+        }
+
+        file.close();
+    }
+}
+
+TEST(FileIOTests, TestFileOpenFailure)
+{
+    std::ifstream file("nonexistent_file_12345.bin", std::ios::binary);
+    EXPECT_FALSE(file.is_open());
+}
+
+TEST(IntegrationTests, TestCommandTypesValues)
+{
+    EXPECT_EQ(0, (int)CMD_READ);
+    EXPECT_EQ(1, (int)CMD_WRITE_REQUEST);
+    EXPECT_EQ(2, (int)CMD_WRITE_SUBMIT);
+    EXPECT_EQ(3, (int)CMD_FINISH_ACCESS);
+    EXPECT_EQ(4, (int)CMD_EXIT);
+}
+
+TEST(IntegrationTests, TestResponseStructure)
+{
+    Response resp{};
+    resp.ok = true;
+    resp.data.num = 100;
+    strncpy(resp.data.name, "Test", sizeof(resp.data.name) - 1);
+    resp.data.hours = 50.5;
+
+    EXPECT_TRUE(resp.ok);
+    EXPECT_EQ(100, resp.data.num);
+    EXPECT_STREQ("Test", resp.data.name);
+    EXPECT_DOUBLE_EQ(50.5, resp.data.hours);
+}
+
+TEST(IntegrationTests, TestRequestStructure)
+{
+    Request req{};
+    req.cmd = CMD_READ;
+    req.id = 42;
+    req.clientPid = 12345;
+    req.data.num = 1;
+    strncpy(req.data.name, "ReqData", sizeof(req.data.name) - 1);
+    req.data.hours = 25.0;
+
+    EXPECT_EQ((int)CMD_READ, (int)req.cmd);
+    EXPECT_EQ(42, req.id);
+    EXPECT_EQ((DWORD)12345, req.clientPid);
+    EXPECT_EQ(1, req.data.num);
+}
+
+TEST(IntegrationTests, TestWaitDefaults)
+{
+    Request req{};
+    EXPECT_EQ(0, req.waitMs);
+
+    Response resp{};
+    EXPECT_EQ((int)ST_OK, (int)resp.status);
+    EXPECT_EQ(-1, WAIT_FOREVER);
+}
+
+TEST(ServerLogicTests, TestDatabaseOperations)
+{
+    MockServerLogic logic;
+    logic.loadTestData();
+
+    EXPECT_EQ((size_t)3, logic.getRecordCount());
+
+    EXPECT_TRUE(logic.recordExists(1));
+    EXPECT_FALSE(logic.recordExists(999));
+}
+
+TEST(ServerLogicTests, TestReadRecordSuccess)
+{
+    MockServerLogic logic;
+    logic.loadTestData();
+
+    employee result{};
+    bool success = logic.readRecord(1, result);
+
+    EXPECT_TRUE(success);
+    EXPECT_EQ(1, result.num);
+    EXPECT_STREQ("John", result.name);
+    EXPECT_DOUBLE_EQ(40.5, result.hours);
+}
+
+TEST(ServerLogicTests, TestReadRecordNotFound)
+{
+    MockServerLogic logic;
+    logic.loadTestData();
+
+    employee result{};
+    bool success = logic.readRecord(999, result);
+
+    EXPECT_FALSE(success);
+}
+
+TEST(ServerLogicTests, TestWriteRecordSuccess)
+{
+    MockServerLogic logic;
+    logic.loadTestData();
+
+    employee newEmp{ 4, "Charlie", 38.0 };
+    bool success = logic.writeRecord(4, newEmp);
+
+    EXPECT_TRUE(success);
+    EXPECT_TRUE(logic.recordExists(4));
+}
+
+TEST(ServerLogicTests, TestConcurrentAccessPrevention)
+{
+    MockServerLogic logic;
+    logic.loadTestData();
+
+    employee result1{};
+    bool success1 = logic.readRecord(1, result1);
+    EXPECT_TRUE(success1);
+
+    employee result2{};
+    bool success2 = logic.readRecord(1, result2);
+    EXPECT_FALSE(success2);
+
+    logic.releaseLock(1);
+    bool success3 = logic.readRecord(1, result2);
+    EXPECT_TRUE(success3);
+}
+
+TEST(PlatformTests, TestListenKeepsLiveEndpoint)
+{
+    std::string name = "lab5_test_busy_" + std::to_string(currentProcessId());
+
+    ipc::Listener owner;
+    ASSERT_TRUE(owner.listen(name));
+
+    ipc::Listener intruder;
+    EXPECT_FALSE(intruder.listen(name));
+
+    ipc::Connection conn;
+    EXPECT_TRUE(ipc::connect(name, conn));
+
+    // После закрытия имя снова свободно.
+    conn.close();
+    owner.close();
+    EXPECT_TRUE(intruder.listen(name));
+}
+
+TEST(PlatformTests, TestConnectionRoundTrip)
+{
+    std::string name = "lab5_test_pipe_" + std::to_string(currentProcessId());
+
+    ipc::Listener listener;
+    ASSERT_TRUE(listener.listen(name));
+
+    ipc::Connection client;
+    ASSERT_TRUE(ipc::connect(name, client));
+
+    Request req{};
+    req.cmd = CMD_WRITE_SUBMIT;
+    req.id = 7;
+    req.clientPid = currentProcessId();
+    strncpy(req.data.name, "Pipe", sizeof(req.data.name) - 1);
+    ASSERT_TRUE(client.sendAll(&req, sizeof(req)));
+
+    ipc::Connection server;
+    ASSERT_TRUE(listener.accept(server));
+
+    Request received{};
+    ASSERT_TRUE(server.recvAll(&received, sizeof(received)));
+    EXPECT_EQ((int)CMD_WRITE_SUBMIT, (int)received.cmd);
+    EXPECT_EQ(7, received.id);
+    EXPECT_STREQ("Pipe", received.data.name);
+
+    Response resp{};
+    resp.ok = true;
+    ASSERT_TRUE(server.sendAll(&resp, sizeof(resp)));
+    server.close();
+
+    Response answer{};
+    ASSERT_TRUE(client.recvAll(&answer, sizeof(answer)));
+    EXPECT_TRUE(answer.ok);
+    EXPECT_FALSE(client.recvAll(&answer, sizeof(answer)));
+}
+
+TEST(SharedStoreTests, TestPublishAndLookup)
+{
+    std::string name = "lab5_test_store_" + std::to_string(currentProcessId());
+
+    SharedStore server;
+    ASSERT_TRUE(server.create(name));
+
+    SharedStore client;
+    ASSERT_TRUE(client.open(name));
+
+    employee e{ 5, "Shared", 12.5 };
+    ASSERT_TRUE(server.publish(e, 1));
+
+    employee found{};
+    std::uint32_t version = 0;
+    ASSERT_TRUE(client.lookup(5, found, &version));
+    EXPECT_STREQ("Shared", found.name);
+    EXPECT_DOUBLE_EQ(12.5, found.hours);
+    EXPECT_EQ(1u, version);
+
+    EXPECT_FALSE(client.lookup(6, found));
+}
+
+TEST(SharedStoreTests, TestCreateRefusesLiveRegion)
+{
+    std::string name = "lab5_test_store_live_" + std::to_string(currentProcessId());
+
+    SharedStore first;
+    ASSERT_TRUE(first.create(name));
+    ASSERT_TRUE(first.publish(employee{ 1, "Alpha", 1.0 }, 1));
+
+    // Область держит работающий процесс — второй владелец её не затирает.
+    SharedStore second;
+    EXPECT_FALSE(second.create(name));
+
+    SharedStore client;
+    ASSERT_TRUE(client.open(name));
+    employee found{};
+    ASSERT_TRUE(client.lookup(1, found));
+    EXPECT_STREQ("Alpha", found.name);
+    client.close();
+
+    first.close();
+    EXPECT_TRUE(second.create(name));
+}
+
+TEST(SharedStoreTests, TestUpdateReplacesVersion)
+{
+    std::string name = "lab5_test_store_upd_" + std::to_string(currentProcessId());
+
+    SharedStore store;
+    ASSERT_TRUE(store.create(name));
+
+    employee e{ 1, "Old", 1.0 };
+    store.publish(e, 0);
+    strncpy(e.name, "New", sizeof(e.name) - 1);
+    e.hours = 2.0;
+    store.publish(e, 1);
+
+    employee found{};
+    std::uint32_t version = 0;
+    ASSERT_TRUE(store.lookup(1, found, &version));
+    EXPECT_STREQ("New", found.name);
+    EXPECT_EQ(1u, version);
+}
+
+TEST(EventListenerTests, TestReceivesBatch)
+{
+    DWORD pid = currentProcessId();
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<ChangeEvent> received;
+    bool receivedOverflow = true;
+    bool done = false;
+
+    EventListener listener;
+    ASSERT_TRUE(listener.start(pid, [&](const std::vector<ChangeEvent>& events, bool overflow) {
+        std::lock_guard<std::mutex> guard(m);
+        received = events;
+        receivedOverflow = overflow;
+        done = true;
+        cv.notify_one();
+    }));
+
+    ChangeEvent events[2] = {
+        { 1, 3, { 1, "One", 1.0 }, false },
+        { 2, 7, { 2, "Two", 2.0 }, false }
+    };
+    EventBatch batch{ 2, false, 5 };
+
+    ipc::Connection conn;
+    ASSERT_TRUE(ipc::connect(clientEventsPipeName(pid), conn));
+    ASSERT_TRUE(conn.sendAll(&batch, sizeof(batch)));
+    ASSERT_TRUE(conn.sendAll(events, sizeof(events)));
+    conn.close();
+
+    {
+        std::unique_lock<std::mutex> guard(m);
+        ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(5), [&] { return done; }));
+    }
+    listener.stop();
+
+    ASSERT_EQ(2u, received.size());
+    EXPECT_FALSE(receivedOverflow);
+    EXPECT_EQ(5u, listener.epoch());
+    EXPECT_EQ(7u, received[1].version);
+    EXPECT_STREQ("Two", received[1].data.name);
+}
+
+TEST(ReadCacheTests, TestEvictsLeastRecentlyUsed)
+{
+    ReadCache cache(2);
+    cache.put(employee{ 1, "One", 1.0 }, 0);
+    cache.put(employee{ 2, "Two", 2.0 }, 0);
+
+    employee e{};
+    ASSERT_TRUE(cache.get(1, e));
+
+    cache.put(employee{ 3, "Three", 3.0 }, 0);
+
+    EXPECT_EQ((size_t)2, cache.size());
+    EXPECT_TRUE(cache.get(1, e));
+    EXPECT_FALSE(cache.get(2, e));
+    EXPECT_TRUE(cache.get(3, e));
+}
+
+TEST(ReadCacheTests, TestOlderVersionIgnored)
+{
+    ReadCache cache;
+    cache.put(employee{ 1, "New", 2.0 }, 5);
+    cache.put(employee{ 1, "Old", 1.0 }, 4);
+
+    employee e{};
+    std::uint32_t version = 0;
+    ASSERT_TRUE(cache.get(1, e, &version));
+    EXPECT_STREQ("New", e.name);
+    EXPECT_EQ(5u, version);
+}
+
+TEST(ReadCacheTests, TestApplyEvents)
+{
+    ReadCache cache;
+    cache.put(employee{ 1, "One", 1.0 }, 0);
+    cache.put(employee{ 2, "Two", 2.0 }, 0);
+
+    std::vector<ChangeEvent> events = {
+        { 1, 1, { 1, "Changed", 10.0 }, false },
+        { 7, 1, { 7, "Unknown", 7.0 }, false }
+    };
+    cache.apply(events, false);
+
+    employee e{};
+    ASSERT_TRUE(cache.get(1, e));
+    EXPECT_STREQ("Changed", e.name);
+    EXPECT_FALSE(cache.get(7, e));
+
+    cache.apply(std::vector<ChangeEvent>(), true);
+    EXPECT_EQ((size_t)0, cache.size());
+}
+
+TEST(ReadCacheTests, TestReadOvertakenByEventNotStored)
+{
+    ReadCache cache;
+    std::uint64_t generation = cache.generation();
+
+    // Запись прочитана в версии 1, но уведомление о версии 2 пришло раньше.
+    ChangeEvent ev{};
+    ev.id = 5;
+    ev.version = 2;
+    ev.data = employee{ 5, "New", 2.0 };
+    ev.deleted = false;
+    cache.apply(std::vector<ChangeEvent>{ ev }, false);
+
+    employee e{};
+    cache.put(employee{ 5, "Old", 1.0 }, 1, generation);
+    EXPECT_FALSE(cache.get(5, e));
+
+    cache.put(employee{ 5, "New", 2.0 }, 2, generation);
+    ASSERT_TRUE(cache.get(5, e));
+    EXPECT_STREQ("New", e.name);
+
+    // Сброс из-за потерянных уведомлений отменяет начатые до него чтения.
+    generation = cache.generation();
+    cache.apply(std::vector<ChangeEvent>(), true);
+    cache.put(employee{ 6, "Stale", 1.0 }, 1, generation);
+    EXPECT_FALSE(cache.get(6, e));
+}
+
+TEST(ReadCacheTests, TestNewEpochClearsCache)
+{
+    ReadCache cache;
+    EXPECT_FALSE(cache.setEpoch(11));
+    cache.put(employee{ 1, "Before", 1.0 }, 5);
+    EXPECT_FALSE(cache.setEpoch(11));
+    EXPECT_FALSE(cache.setEpoch(0));
+    EXPECT_EQ(1u, cache.size());
+
+    // После перезапуска сервера версии начинаются заново.
+    EXPECT_TRUE(cache.setEpoch(12));
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_EQ(12u, cache.epoch());
+    cache.put(employee{ 1, "After", 2.0 }, 0);
+
+    employee e{};
+    ASSERT_TRUE(cache.get(1, e));
+    EXPECT_STREQ("After", e.name);
+}
+
+TEST(ReadCacheTests, TestNotifiedVersionsBounded)
+{
+    ReadCache cache(2);
+    std::uint64_t generation = cache.generation();
+
+    std::vector<ChangeEvent> events;
+    for (int id = 1; id <= 2; id++) {
+        ChangeEvent ev{};
+        ev.id = id;
+        ev.version = 3;
+        events.push_back(ev);
+    }
+    cache.apply(events, false);
+    EXPECT_EQ(generation, cache.generation());
+
+    // Третья незакэшированная запись не помещается: запомненное забывается,
+    // а чтения, начатые раньше, не сохраняются.
+    events[0].id = 3;
+    cache.apply(std::vector<ChangeEvent>{ events[0] }, false);
+    EXPECT_NE(generation, cache.generation());
+
+    employee e{};
+    cache.put(employee{ 1, "Old", 1.0 }, 1, generation);
+    EXPECT_FALSE(cache.get(1, e));
+
+    cache.put(employee{ 1, "Fresh", 1.0 }, 1, cache.generation());
+    EXPECT_TRUE(cache.get(1, e));
+}
+
+TEST(SnapshotTests, TestWritesOnlyDirtySlots)
+{
+    const char* testFileName = "test_snapshot.bin";
+    std::vector<employee> employees = {
+        {1, "First", 10.0},
+        {2, "Second", 20.0},
+        {3, "Third", 30.0}
+    };
+    ASSERT_TRUE(writeRecordFile(testFileName, employees));
+
+    std::map<size_t, employee> dirty;
+    dirty[1] = employee{ 2, "Changed", 25.0 };
+    dirty[3] = employee{ 4, "Fourth", 40.0 };
+    ASSERT_TRUE(writeSnapshot(testFileName, dirty, 4));
+
+    std::vector<employee> readEmp;
+    ASSERT_EQ(RF_OK, readRecordFile(testFileName, readEmp));
+    ASSERT_EQ((size_t)4, readEmp.size());
+
+    EXPECT_STREQ("First", readEmp[0].name);
+    EXPECT_STREQ("Changed", readEmp[1].name);
+    EXPECT_DOUBLE_EQ(25.0, readEmp[1].hours);
+    EXPECT_STREQ("Third", readEmp[2].name);
+    EXPECT_EQ(4, readEmp[3].num);
+
+    std::ifstream tmp("test_snapshot.bin.tmp", std::ios::binary);
+    EXPECT_FALSE(tmp.is_open());
+}
+
+TEST(SnapshotTests, TestCheckpointerFlushesOnStop)
+{
+    const char* testFileName = "test_checkpoint.bin";
+    std::remove(testFileName);
+
+    Checkpointer checkpointer;
+    checkpointer.start(testFileName, 0);
+
+    std::map<size_t, employee> records;
+    records[0] = employee{ 1, "One", 1.0 };
+    checkpointer.submit(records, 1);
+    checkpointer.stop();
+
+    std::vector<employee> readEmp;
+    ASSERT_EQ(RF_OK, readRecordFile(testFileName, readEmp));
+    ASSERT_EQ((size_t)1, readEmp.size());
+    EXPECT_STREQ("One", readEmp[0].name);
+}
+
+TEST(SnapshotTests, TestTruncatesToSlotCount)
+{
+    const char* testFileName = "test_snapshot_trunc.bin";
+    std::vector<employee> employees = {
+        {1, "First", 10.0},
+        {2, "Second", 20.0},
+        {3, "Third", 30.0}
+    };
+    ASSERT_TRUE(writeRecordFile(testFileName, employees));
+
+    // Запись из последнего слота перенесена на место удалённой второй.
+    std::map<size_t, employee> dirty;
+    dirty[1] = employee{ 3, "Third", 30.0 };
+    dirty[2] = employee{ TOMBSTONE_ID, "", 0.0 };
+    ASSERT_TRUE(writeSnapshot(testFileName, dirty, 2));
+
+    std::ifstream file(testFileName, std::ios::binary | std::ios::ate);
+    ASSERT_TRUE(file.is_open());
+    EXPECT_EQ((std::streamoff)recordOffset(2), (std::streamoff)file.tellg());
+    file.close();
+
+    std::vector<employee> readEmp;
+    ASSERT_EQ(RF_OK, readRecordFile(testFileName, readEmp));
+    ASSERT_EQ((size_t)2, readEmp.size());
+    EXPECT_EQ(1, readEmp[0].num);
+    EXPECT_EQ(3, readEmp[1].num);
+}
+
+TEST(SharedStoreTests, TestRemoveHidesRecord)
+{
+    std::string name = "lab5_test_store_rm_" + std::to_string(currentProcessId());
+
+    SharedStore store;
+    ASSERT_TRUE(store.create(name));
+
+    employee e{ 9, "Gone", 1.0 };
+    store.publish(e, 0);
+    ASSERT_TRUE(store.remove(9, 1));
+
+    employee found{};
+    EXPECT_FALSE(store.lookup(9, found));
+
+    store.publish(e, 2);
+    std::uint32_t version = 0;
+    ASSERT_TRUE(store.lookup(9, found, &version));
+    EXPECT_EQ(2u, version);
+}
+
+TEST(SharedStoreTests, TestReusesSlotsOfRemovedRecords)
+{
+    std::string name = "lab5_test_store_reuse_" + std::to_string(currentProcessId());
+
+    SharedStore store;
+    ASSERT_TRUE(store.create(name));
+
+    // Записей за время работы больше, чем слотов, но живых — по одной.
+    employee e{ 0, "Temp", 1.0 };
+    for (int id = 1; id <= (int)SHARED_STORE_CAPACITY * 2; id++) {
+        e.num = id;
+        ASSERT_TRUE(store.publish(e, 1)) << id;
+        ASSERT_TRUE(store.remove(id, 2));
+    }
+
+    e.num = 7;
+    ASSERT_TRUE(store.publish(e, 5));
+    employee found{};
+    std::uint32_t version = 0;
+    ASSERT_TRUE(store.lookup(7, found, &version));
+    EXPECT_EQ(5u, version);
+    EXPECT_FALSE(store.lookup(8, found));
+}
+
+TEST(PoolTests, TestReleasedObjectIsReused)
+{
+    ObjectPool<employee, 4> pool;
+    employee* first = pool.acquire(employee{ 1, "One", 1.0 });
+    employee* second = pool.acquire(employee{ 2, "Two", 2.0 });
+    EXPECT_EQ(2u, pool.inUse());
+    EXPECT_EQ(4u, pool.capacity());
+    EXPECT_EQ(2, second->num);
+
+    pool.release(first);
+    employee* third = pool.acquire(employee{ 3, "Three", 3.0 });
+    EXPECT_EQ(first, third);
+    EXPECT_EQ(3, third->num);
+    EXPECT_EQ(2u, pool.inUse());
+
+    // Пятый объект не помещается в первый блок — пул выделяет следующий.
+    for (int i = 0; i < 3; i++) pool.acquire(employee{ 10 + i, "More", 0.0 });
+    EXPECT_EQ(5u, pool.inUse());
+    EXPECT_EQ(8u, pool.capacity());
+}
+
+TEST(PoolTests, TestRingBufferKeepsOrderAcrossGrowth)
+{
+    RingBuffer<int> queue(2);
+    queue.push_back(1);
+    queue.push_back(2);
+    queue.pop_front();
+    queue.push_back(3);
+    EXPECT_EQ(2u, queue.capacity());
+
+    queue.push_back(4);
+    EXPECT_EQ(4u, queue.capacity());
+    ASSERT_EQ(3u, queue.size());
+
+    for (int expected = 2; expected <= 4; expected++) {
+        ASSERT_FALSE(queue.empty());
+        EXPECT_EQ(expected, queue.front());
+        queue.pop_front();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(RecordFormatTests, TestRecordLayoutIsExplicit)
+{
+    employee e{ 0x01020304, "Name", 1.5 };
+    unsigned char raw[RECORD_SIZE];
+    encodeRecord(e, raw);
+
+    // num в little-endian, имя со смещения 4, hours со смещения 16.
+    EXPECT_EQ(0x04, raw[0]);
+    EXPECT_EQ(0x01, raw[3]);
+    EXPECT_EQ('N', raw[4]);
+    EXPECT_EQ(0, raw[14]);
+    EXPECT_EQ(0x3F, raw[23]);
+
+    employee decoded = decodeRecord(raw);
+    EXPECT_EQ(e.num, decoded.num);
+    EXPECT_STREQ("Name", decoded.name);
+    EXPECT_DOUBLE_EQ(1.5, decoded.hours);
+}
+
+TEST(RecordFormatTests, TestDetectsCorruption)
+{
+    const char* testFileName = "test_format_crc.bin";
+    std::vector<employee> employees = { {1, "First", 10.0}, {2, "Second", 20.0} };
+    ASSERT_TRUE(writeRecordFile(testFileName, employees));
+
+    {
+        std::fstream file(testFileName, std::ios::binary | std::ios::in | std::ios::out);
+        ASSERT_TRUE(file.is_open());
+        file.seekp((std::streamoff)recordOffset(1) + 4);
+        file.put('X');
+    }
+
+    std::vector<employee> readEmp;
+    EXPECT_EQ(RF_CORRUPTED, readRecordFile(testFileName, readEmp));
+    std::remove(testFileName);
+}
+
+TEST(RecordFormatTests, TestBadHeaderIsNotLegacy)
+{
+    const char* testFileName = "test_format_header.bin";
+    std::vector<employee> employees = { {1, "First", 10.0} };
+    ASSERT_TRUE(writeRecordFile(testFileName, employees));
+
+    {
+        // Версия формата из будущего при верном magic.
+        std::fstream file(testFileName, std::ios::binary | std::ios::in | std::ios::out);
+        ASSERT_TRUE(file.is_open());
+        file.seekp(4);
+        file.put((char)(RECORD_FILE_VERSION + 1));
+    }
+
+    std::vector<employee> readEmp;
+    EXPECT_EQ(RF_CORRUPTED, readRecordFile(testFileName, readEmp));
+    EXPECT_FALSE(convertRecordFile(testFileName, testFileName));
+
+    {
+        // Без magic, но длина не кратна записи версии 1.
+        std::ofstream file(testFileName, std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(file.is_open());
+        employee e = { 1, "First", 10.0 };
+        file.write(reinterpret_cast<const char*>(&e), sizeof(e));
+        file.put('X');
+    }
+    EXPECT_EQ(RF_CORRUPTED, readRecordFile(testFileName, readEmp));
+    std::remove(testFileName);
+}
+
+TEST(RecordFormatTests, TestConvertsLegacyFile)
+{
+    const char* legacyName = "test_format_v1.bin";
+    const char* convertedName = "test_format_v2.bin";
+    {
+        std::ofstream file(legacyName, std::ios::binary | std::ios::trunc);
+        ASSERT_TRUE(file.is_open());
+        employee employees[2] = {
+            {1, "First", 10.0},
+            {TOMBSTONE_ID, "", 0.0}
+        };
+        file.write(reinterpret_cast<const char*>(employees), sizeof(employees));
+    }
+
+    std::vector<employee> readEmp;
+    EXPECT_EQ(RF_LEGACY, readRecordFile(legacyName, readEmp));
+    EXPECT_EQ((size_t)2, readEmp.size());
+
+    ASSERT_TRUE(convertRecordFile(legacyName, convertedName));
+    ASSERT_EQ(RF_OK, readRecordFile(convertedName, readEmp));
+    ASSERT_EQ((size_t)2, readEmp.size());
+    EXPECT_STREQ("First", readEmp[0].name);
+    EXPECT_EQ(TOMBSTONE_ID, readEmp[1].num);
+
+    std::remove(legacyName);
+    std::remove(convertedName);
+}
+
+TEST(ReplicationTests, TestSnapshotThenChanges)
+{
+    DWORD pid = currentProcessId();
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<ReplicationBatch> batches;
+    std::vector<ChangeEvent> received;
+
+    ReplicationSink sink;
+    ASSERT_TRUE(sink.start(pid, [&](const std::vector<ChangeEvent>& events, bool reset, std::uint64_t lsn) {
+        std::lock_guard<std::mutex> guard(m);
+        batches.push_back(ReplicationBatch{ lsn, (std::uint32_t)events.size(), reset });
+        received.insert(received.end(), events.begin(), events.end());
+        cv.notify_one();
+    }));
+
+    ReplicationSource source;
+    source.start();
+
+    std::vector<ChangeEvent> snapshot = {
+        { 1, 0, { 1, "One", 1.0 }, false },
+        { 2, 0, { 2, "Two", 2.0 }, false }
+    };
+    source.addReplica(pid, snapshot, 5);
+    {
+        std::unique_lock<std::mutex> guard(m);
+        ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(5), [&] { return batches.size() == 1; }));
+    }
+
+    ChangeEvent removed{ 2, 1, {}, true };
+    source.publish(removed, 6);
+    {
+        std::unique_lock<std::mutex> guard(m);
+        ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(5), [&] { return batches.size() == 2; }));
+    }
+    source.stop();
+    sink.stop();
+
+    EXPECT_TRUE(batches[0].reset);
+    EXPECT_EQ(2u, batches[0].count);
+    EXPECT_EQ(5u, batches[0].lsn);
+    EXPECT_FALSE(batches[1].reset);
+    EXPECT_EQ(6u, batches[1].lsn);
+    ASSERT_EQ(3u, received.size());
+    EXPECT_TRUE(received[2].deleted);
+    EXPECT_EQ(1u, source.replicaCount());
+}
+
+TEST(ReplicationTests, TestHeartbeatWithoutChanges)
+{
+    DWORD pid = currentProcessId();
+
+    std::mutex m;
+    std::condition_variable cv;
+    int batches = 0;
+
+    ReplicationSink sink;
+    ASSERT_TRUE(sink.start(pid, [&](const std::vector<ChangeEvent>&, bool, std::uint64_t) {
+        std::lock_guard<std::mutex> guard(m);
+        batches++;
+        cv.notify_one();
+    }));
+
+    ReplicationSource source(20);
+    source.start();
+    source.addReplica(pid, std::vector<ChangeEvent>(), 3);
+    {
+        std::unique_lock<std::mutex> guard(m);
+        ASSERT_TRUE(cv.wait_for(guard, std::chrono::seconds(5), [&] { return batches == 1; }));
+    }
+
+    // Пустые пачки доходят до приёмника, но не до обработчика.
+    std::chrono::steady_clock::time_point first = sink.lastHeard();
+    sleepMs(200);
+    EXPECT_GT(sink.lastHeard(), first);
+
+    source.stop();
+    sink.stop();
+    std::lock_guard<std::mutex> guard(m);
+    EXPECT_EQ(1, batches);
+}
+
+TEST(ReplicationTests, TestUnreachableReplicaDropped)
+{
+    ReplicationSource source;
+    source.start();
+
+    // Приёмник не запущен: доставка не удаётся, резервный отключается.
+    source.addReplica(currentProcessId(), std::vector<ChangeEvent>(), 0);
+    for (int i = 0; i < 100 && source.replicaCount() > 0; i++) {
+        sleepMs(10);
+    }
+    EXPECT_EQ(0u, source.replicaCount());
+    source.stop();
+}
+
+static Request makeRequest(DWORD pid, CommandType cmd, int id)
+{
+    Request req{};
+    req.cmd = cmd;
+    req.clientPid = pid;
+    req.id = id;
+    return req;
+}
+
+TEST(AdmissionTests, TestRoundRobinAcrossClients)
+{
+    AdmissionQueue queue;
+    AdmissionQueue::Clock::time_point now = AdmissionQueue::Clock::now();
+
+    for (int i = 1; i <= 3; i++) {
+        ASSERT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, i), now));
+    }
+    ASSERT_EQ(ADMIT_OK, queue.push(makeRequest(200, CMD_READ, 10), now));
+
+    // Клиент 200 не ждёт, пока обработаются все запросы клиента 100.
+    int expected[4] = { 1, 10, 2, 3 };
+    for (int id : expected) {
+        Request req;
+        ASSERT_TRUE(queue.pop(req));
+        EXPECT_EQ(id, req.id);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(AdmissionTests, TestTokenBucketLimitsRate)
+{
+    AdmissionLimits limits;
+    limits.ratePerSecond = 10.0;
+    limits.burst = 2.0;
+    AdmissionQueue queue(limits);
+    AdmissionQueue::Clock::time_point now = AdmissionQueue::Clock::now();
+
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 1), now));
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 2), now));
+    EXPECT_EQ(ADMIT_RATE_LIMITED, queue.push(makeRequest(100, CMD_READ, 3), now));
+
+    // Снятие блокировки принимается и без жетонов.
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_FINISH_ACCESS, 1), now));
+
+    now += std::chrono::milliseconds(100);
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 3), now));
+    EXPECT_EQ(4u, queue.size());
+}
+
+TEST(AdmissionTests, TestQueueLimits)
+{
+    AdmissionLimits limits;
+    limits.maxQueued = 3;
+    limits.sessionQueue = 2;
+    AdmissionQueue queue(limits);
+    AdmissionQueue::Clock::time_point now = AdmissionQueue::Clock::now();
+
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 1), now));
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 2), now));
+    EXPECT_EQ(ADMIT_SESSION_FULL, queue.push(makeRequest(100, CMD_READ, 3), now));
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(200, CMD_READ, 4), now));
+    EXPECT_EQ(ADMIT_OVERLOADED, queue.push(makeRequest(300, CMD_READ, 5), now));
+    EXPECT_EQ(3u, queue.size());
+}
+
+TEST(AdmissionTests, TestLockDumpLimitedPerClient)
+{
+    AdmissionLimits limits;
+    limits.maxQueued = 1;
+    limits.ratePerSecond = 1.0;
+    limits.burst = 2.0;
+    AdmissionQueue queue(limits);
+    AdmissionQueue::Clock::time_point now = AdmissionQueue::Clock::now();
+
+    // Общий предел очередей таблице блокировок не мешает...
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(100, CMD_READ, 1), now));
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(200, CMD_LOCK_DUMP, 0), now));
+    EXPECT_EQ(ADMIT_OK, queue.push(makeRequest(200, CMD_LOCK_DUMP, 0), now));
+    // ...но ведро жетонов клиента действует.
+    EXPECT_EQ(ADMIT_RATE_LIMITED, queue.push(makeRequest(200, CMD_LOCK_DUMP, 0), now));
+    EXPECT_EQ(3u, queue.size());
+}
+
+TEST(BatchTests, TestParsesScriptLines)
+{
+    BatchOp op;
+    ASSERT_EQ(PARSE_OK, parseBatchLine("update 7 Ivan 12.5", op));
+    EXPECT_EQ(OP_UPDATE, op.type);
+    EXPECT_EQ(7, op.id);
+    EXPECT_EQ(7, op.data.num);
+    EXPECT_STREQ("Ivan", op.data.name);
+    EXPECT_DOUBLE_EQ(12.5, op.data.hours);
+
+    ASSERT_EQ(PARSE_OK, parseBatchLine("  read 3", op));
+    EXPECT_EQ(OP_READ, op.type);
+
+    EXPECT_EQ(PARSE_SKIP, parseBatchLine("", op));
+    EXPECT_EQ(PARSE_SKIP, parseBatchLine("# comment", op));
+    EXPECT_EQ(PARSE_ERROR, parseBatchLine("move 1", op));
+    EXPECT_EQ(PARSE_ERROR, parseBatchLine("update 1 Ivan", op));
+    EXPECT_EQ(PARSE_ERROR, parseBatchLine("insert 1 VeryLongName 3", op));
+    EXPECT_EQ(PARSE_ERROR, parseBatchLine("delete 1 2", op));
+}
+
+TEST(BatchTests, TestUpdateResultFromResponses)
+{
+    BatchOp op;
+    ASSERT_EQ(PARSE_OK, parseBatchLine("update 4 Olga 8", op));
+    op.line = 2;
+
+    std::vector<Request> requests;
+    appendBatchRequests(op, requests);
+    ASSERT_EQ(batchRequestCount(op), requests.size());
+    EXPECT_EQ(CMD_WRITE_REQUEST, requests[0].cmd);
+    EXPECT_EQ(CMD_WRITE_SUBMIT, requests[1].cmd);
+    EXPECT_EQ(CMD_FINISH_ACCESS, requests[2].cmd);
+
+    Response responses[3] = {};
+    responses[0].ok = true;
+    responses[1].ok = true;
+    responses[1].version = 5;
+    responses[2].ok = true;
+    BatchResult result = batchResult(op, responses);
+    EXPECT_TRUE(result.ok);
+    EXPECT_EQ("2\tupdate\t4\tok\t5\tOlga\t8", formatBatchResult(op, result));
+
+    responses[0].ok = false;
+    responses[0].status = ST_BUSY;
+    result = batchResult(op, responses);
+    EXPECT_FALSE(result.ok);
+    EXPECT_EQ("2\tupdate\t4\tbusy\t-\t-\t-", formatBatchResult(op, result));
+}
+
+static BatchResult batchFailure(ResponseStatus status)
+{
+    BatchResult r{};
+    r.status = status;
+    return r;
+}
+
+TEST(BatchTests, TestRetriesKeepOrderPerRecord)
+{
+    std::vector<BatchOp> ops(5);
+    ASSERT_EQ(PARSE_OK, parseBatchLine("update 1 Ivan 3", ops[0]));
+    ASSERT_EQ(PARSE_OK, parseBatchLine("read 1", ops[1]));
+    ASSERT_EQ(PARSE_OK, parseBatchLine("update 2 Olga 4", ops[2]));
+    ASSERT_EQ(PARSE_OK, parseBatchLine("read 2", ops[3]));
+    ASSERT_EQ(PARSE_OK, parseBatchLine("delete 3", ops[4]));
+
+    std::vector<BatchResult> results(5);
+    results[0] = batchFailure(ST_BUSY);
+    results[1].ok = true;
+    results[2] = batchFailure(ST_BUSY);
+    results[3] = batchFailure(ST_OVERLOADED);
+    results[4] = batchFailure(ST_NOT_FOUND);
+    std::vector<size_t> pending = { 0, 1, 2, 3, 4 };
+
+    // Запись 1 уже прочитана после отказа её изменению — изменение не
+    // повторяется; обе операции над записью 2 повторяются по порядку.
+    std::vector<size_t> retry = batchRetries(ops, pending, results, false);
+    EXPECT_EQ(std::vector<size_t>({ 2, 3 }), retry);
+
+    EXPECT_TRUE(batchRetries(ops, pending, results, true).empty());
+}
+
+static LockDumpEntry lockEntry(int id, DWORD pid, LockDumpMode mode, std::uint32_t position)
+{
+    LockDumpEntry e{};
+    e.id = id;
+    e.pid = pid;
+    e.mode = mode;
+    e.position = position;
+    return e;
+}
+
+TEST(LockReportTests, TestFindsWaitCycle)
+{
+    // 100 держит 1 и ждёт 2, 200 держит 2 и ждёт 1; 300 просто ждёт 1 за ними.
+    std::vector<LockDumpEntry> entries;
+    entries.push_back(lockEntry(1, 100, LOCK_HELD_WRITE, 0));
+    entries.push_back(lockEntry(1, 200, LOCK_WAIT_WRITE, 1));
+    entries.push_back(lockEntry(1, 300, LOCK_WAIT_READ, 2));
+    entries.push_back(lockEntry(2, 200, LOCK_HELD_READ, 0));
+    entries.push_back(lockEntry(2, 100, LOCK_WAIT_WRITE, 1));
+    entries.push_back(lockEntry(3, 400, LOCK_HELD_READ, 0));
+    entries.push_back(lockEntry(3, 500, LOCK_WAIT_READ, 1));
+
+    EXPECT_EQ(1u, markWaitCycles(entries));
+    EXPECT_EQ(1u, entries[1].cycle);
+    EXPECT_EQ(1u, entries[4].cycle);
+    EXPECT_EQ(0u, entries[0].cycle);
+    EXPECT_EQ(0u, entries[2].cycle);
+    EXPECT_EQ(0u, entries[6].cycle);
+
+    // Читатели друг другу не мешают: без писателя цикла нет.
+    entries[4].mode = LOCK_WAIT_READ;
+    entries[0].mode = LOCK_HELD_READ;
+    entries[1].mode = LOCK_WAIT_READ;
+    EXPECT_EQ(0u, markWaitCycles(entries));
+}
+
+TEST(LockReportTests, TestSelfWaitAndLongHolds)
+{
+    // Читатель, ждущий записи той же записи, ждёт сам себя.
+    std::vector<LockDumpEntry> entries;
+    entries.push_back(lockEntry(5, 100, LOCK_HELD_READ, 0));
+    entries.push_back(lockEntry(5, 100, LOCK_WAIT_WRITE, 1));
+    entries.push_back(lockEntry(6, 200, LOCK_HELD_WRITE, 0));
+    entries[0].durationMs = 9000;
+    entries[1].durationMs = 8000;
+    entries[2].durationMs = 10;
+
+    EXPECT_EQ(1u, markWaitCycles(entries));
+    EXPECT_EQ(1u, entries[1].cycle);
+
+    EXPECT_EQ(1u, markLongHolds(entries, 5000));
+    EXPECT_TRUE(entries[0].longHold);
+    EXPECT_FALSE(entries[1].longHold);
+    EXPECT_FALSE(entries[2].longHold);
+}
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+// Настоящий сервер в отдельном процессе: ему отвечают на вопросы при запуске,
+// а запросы от имени разных клиентов отправляются из теста с выдуманными PID.
+// С load сервер открывает готовый файл (--load) вместо создания из records;
+// options добавляются к командной строке как есть; serverName — имя канала
+// вместо выдуманного (например, для перезапуска под прежним именем).
+class ServerProcess {
+public:
+    explicit ServerProcess(const std::vector<employee>& records, const std::string& load = "",
+        const std::string& options = "", const std::string& serverName = "")
+        : process(nullptr)
+    {
+        static int started = 0;
+        std::string suffix = std::to_string(currentProcessId()) + "_" + std::to_string(++started);
+        name = serverName.empty() ? "lab5_test_server_" + suffix : serverName;
+        file = load.empty() ? "lab5_test_server_" + suffix + ".bin" : load;
+        log = "lab5_test_server_" + suffix + ".log";
+
+        std::string command = std::string("\"") + LAB5_SERVER_PATH + "\" --name " + name
+            + (load.empty() ? "" : " --load " + load) + " " + options + " > " + log + " 2>&1";
+        process = popen(command.c_str(), "w");
+        if (!process) return;
+
+        if (load.empty()) {
+            fprintf(process, "%s\n%d\n", file.c_str(), (int)records.size());
+            for (const employee& e : records) {
+                fprintf(process, "%d\n%s\n%g\n", e.num, e.name, e.hours);
+            }
+        }
+        fprintf(process, "1\n");
+        fflush(process);
+
+        for (int i = 0; i < 500; i++) {
+            ipc::Connection probe;
+            if (ipc::connect(name, probe)) return;
+            sleepMs(10);
+        }
+    }
+
+    ~ServerProcess()
+    {
+        stop();
+        std::remove(file.c_str());
+        std::remove(log.c_str());
+    }
+
+    bool stop()
+    {
+        if (!process) return false;
+        Response resp{};
+        bool sent = sendRequest(makeRequest(clientPid(99), CMD_EXIT, 0), resp, name);
+        pclose(process);
+        process = nullptr;
+        return sent && resp.ok;
+    }
+
+    Response request(const Request& req) const
+    {
+        Response resp{};
+        resp.status = ST_BUSY;
+        if (!sendRequest(req, resp, name)) resp.ok = false;
+        return resp;
+    }
+
+    Response request(DWORD pid, CommandType cmd, int id, int waitMs = 0) const
+    {
+        Request req = makeRequest(pid, cmd, id);
+        req.waitMs = waitMs;
+        return request(req);
+    }
+
+    std::future<Response> requestAsync(DWORD pid, CommandType cmd, int id, int waitMs) const
+    {
+        return std::async(std::launch::async, [=] { return request(pid, cmd, id, waitMs); });
+    }
+
+    static DWORD clientPid(int n)
+    {
+        return currentProcessId() * 100 + n;
+    }
+
+    std::string name;
+    std::string file;
+    std::string log;
+
+private:
+    FILE* process;
+};
+
+static bool isReady(std::future<Response>& f, int ms)
+{
+    return f.wait_for(std::chrono::milliseconds(ms)) == std::future_status::ready;
+}
+
+TEST(ServerLockTests, TestWaitersGrantedInOrder)
+{
+    employee e{ 1, "Ann", 5 };
+    ServerProcess server({ e });
+    DWORD a = ServerProcess::clientPid(1), b = ServerProcess::clientPid(2);
+    DWORD c = ServerProcess::clientPid(3), d = ServerProcess::clientPid(4);
+
+    ASSERT_TRUE(server.request(a, CMD_WRITE_REQUEST, 1).ok);
+    std::future<Response> reader = server.requestAsync(b, CMD_READ, 1, WAIT_FOREVER);
+    sleepMs(100);
+    std::future<Response> writer = server.requestAsync(c, CMD_WRITE_REQUEST, 1, WAIT_FOREVER);
+    sleepMs(100);
+
+    // Новый читатель не обгоняет очередь, хотя читатель в ней первый.
+    Response late = server.request(d, CMD_READ, 1);
+    EXPECT_FALSE(late.ok);
+    EXPECT_EQ(ST_BUSY, late.status);
+    EXPECT_FALSE(isReady(reader, 0));
+
+    ASSERT_TRUE(server.request(a, CMD_FINISH_ACCESS, 1).ok);
+    ASSERT_TRUE(isReady(reader, 2000));
+    EXPECT_TRUE(reader.get().ok);
+    EXPECT_FALSE(isReady(writer, 200));
+
+    ASSERT_TRUE(server.request(b, CMD_FINISH_ACCESS, 1).ok);
+    ASSERT_TRUE(isReady(writer, 2000));
+    EXPECT_TRUE(writer.get().ok);
+    EXPECT_TRUE(server.request(c, CMD_FINISH_ACCESS, 1).ok);
+}
+
+TEST(ServerLockTests, TestWaitExpiresUnderLoad)
+{
+    employee e{ 1, "Ann", 5 };
+    ServerProcess server({ e });
+    DWORD a = ServerProcess::clientPid(1), b = ServerProcess::clientPid(2);
+
+    ASSERT_TRUE(server.request(a, CMD_WRITE_REQUEST, 1).ok);
+    auto start = std::chrono::steady_clock::now();
+    std::future<Response> waiter = server.requestAsync(b, CMD_WRITE_REQUEST, 1, 300);
+
+    // Сервер всё время занят чужими запросами, но срок всё равно истекает.
+    std::vector<std::thread> load;
+    for (int i = 0; i < 4; i++) {
+        load.emplace_back([&, i] {
+            DWORD pid = ServerProcess::clientPid(10 + i);
+            while (!isReady(waiter, 0)
+                && std::chrono::steady_clock::now() - start < std::chrono::seconds(3)) {
+                server.request(pid, CMD_VALIDATE, 1);
+            }
+        });
+    }
+    for (auto& t : load) t.join();
+    ASSERT_TRUE(isReady(waiter, 0));
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    Response resp = waiter.get();
+    EXPECT_FALSE(resp.ok);
+    EXPECT_EQ(ST_TIMEOUT, resp.status);
+    EXPECT_LT(elapsed, 1500);
+}
+
+TEST(ServerLockTests, TestOpenConnectionDoesNotBlockOthers)
+{
+    employee e{ 1, "Ann", 5 };
+    ServerProcess server({ e });
+    DWORD a = ServerProcess::clientPid(1), b = ServerProcess::clientPid(2);
+
+    // Клиенты отправили по запросу и держат подключения открытыми;
+    // их больше, чем у сервера потоков чтения.
+    ipc::Connection held[8];
+    for (ipc::Connection& conn : held) {
+        ASSERT_TRUE(ipc::connect(server.name, conn));
+        Request req = makeRequest(a, CMD_VALIDATE, 1);
+        ASSERT_TRUE(conn.sendAll(&req, sizeof(req)));
+    }
+
+    std::future<Response> other = server.requestAsync(b, CMD_READ, 1, 0);
+    ASSERT_TRUE(isReady(other, 2000));
+    EXPECT_TRUE(other.get().ok);
+    for (ipc::Connection& conn : held) conn.close();
+}
+
+TEST(ServerLockTests, TestReportsWaitCycle)
+{
+    ServerProcess server({ employee{ 1, "Ann", 5 }, employee{ 2, "Bob", 6 } });
+    DWORD a = ServerProcess::clientPid(1), b = ServerProcess::clientPid(2);
+
+    ASSERT_TRUE(server.request(a, CMD_WRITE_REQUEST, 1).ok);
+    ASSERT_TRUE(server.request(b, CMD_WRITE_REQUEST, 2).ok);
+    std::future<Response> first = server.requestAsync(a, CMD_WRITE_REQUEST, 2, 300);
+    sleepMs(100);
+    std::future<Response> second = server.requestAsync(b, CMD_WRITE_REQUEST, 1, 300);
+
+    ASSERT_TRUE(isReady(first, 2000));
+    ASSERT_TRUE(isReady(second, 2000));
+    EXPECT_EQ(ST_TIMEOUT, first.get().status);
+    EXPECT_EQ(ST_TIMEOUT, second.get().status);
+
+    std::ifstream log(server.log);
+    std::string text((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+    EXPECT_NE(std::string::npos, text.find("Обнаружена взаимная блокировка"));
+
+    EXPECT_TRUE(server.request(a, CMD_FINISH_ACCESS, 1).ok);
+    EXPECT_TRUE(server.request(b, CMD_FINISH_ACCESS, 2).ok);
+}
+
+static Response insertRecord(const ServerProcess& server, DWORD pid, const employee& e)
+{
+    Request req = makeRequest(pid, CMD_INSERT, e.num);
+    req.data = e;
+    return server.request(req);
+}
+
+static std::vector<employee> numberedRecords(int count)
+{
+    std::vector<employee> records;
+    for (int id = 1; id <= count; id++) {
+        records.push_back(employee{ id, "Emp", (double)id });
+    }
+    return records;
+}
+
+TEST(ServerRecordTests, TestInsertAndDelete)
+{
+    ServerProcess server(numberedRecords(2));
+    DWORD a = ServerProcess::clientPid(1), b = ServerProcess::clientPid(2);
+
+    EXPECT_EQ(ST_EXISTS, insertRecord(server, a, employee{ 2, "Dup", 1.0 }).status);
+
+    Response inserted = insertRecord(server, a, employee{ 3, "New", 3.0 });
+    ASSERT_TRUE(inserted.ok);
+    EXPECT_EQ(1u, inserted.version);
+
+    // Удаление занятой записи отклоняется, удалённая запись не находится.
+    ASSERT_TRUE(server.request(b, CMD_READ, 3).ok);
+    EXPECT_EQ(ST_BUSY, server.request(a, CMD_DELETE, 3).status);
+    ASSERT_TRUE(server.request(b, CMD_FINISH_ACCESS, 3).ok);
+    Response deleted = server.request(a, CMD_DELETE, 3);
+    ASSERT_TRUE(deleted.ok);
+    EXPECT_EQ(ST_NOT_FOUND, server.request(a, CMD_VALIDATE, 3).status);
+    EXPECT_EQ(ST_NOT_FOUND, server.request(a, CMD_DELETE, 3).status);
+
+    // Добавленная заново запись продолжает нумерацию версий.
+    Response again = insertRecord(server, a, employee{ 3, "Again", 4.0 });
+    ASSERT_TRUE(again.ok);
+    EXPECT_GT(again.version, deleted.version);
+}
+
+TEST(ServerRecordTests, TestInsertReusesFreedSlot)
+{
+    ServerProcess server(numberedRecords(8));
+    DWORD a = ServerProcess::clientPid(1);
+
+    ASSERT_TRUE(server.request(a, CMD_DELETE, 2).ok);
+    ASSERT_TRUE(insertRecord(server, a, employee{ 9, "Nine", 9.0 }).ok);
+    ASSERT_TRUE(server.stop());
+
+    std::vector<employee> file;
+    ASSERT_EQ(RF_OK, readRecordFile(server.file, file));
+    ASSERT_EQ(8u, file.size());
+    EXPECT_EQ(9, file[1].num);
+    EXPECT_STREQ("Nine", file[1].name);
+}
+
+TEST(ServerRecordTests, TestCompactionMovesTailRecords)
+{
+    ServerProcess server(numberedRecords(8));
+    DWORD a = ServerProcess::clientPid(1);
+
+    // Свободна больше четверти слотов: записи с конца переезжают в дыры.
+    for (int id = 1; id <= 3; id++) {
+        ASSERT_TRUE(server.request(a, CMD_DELETE, id).ok);
+    }
+    ASSERT_TRUE(server.stop());
+
+    std::vector<employee> file;
+    ASSERT_EQ(RF_OK, readRecordFile(server.file, file));
+    ASSERT_EQ(6u, file.size());
+    int expected[] = { 8, 7, TOMBSTONE_ID, 4, 5, 6 };
+    for (size_t i = 0; i < file.size(); i++) {
+        EXPECT_EQ(expected[i], file[i].num) << i;
+    }
+    EXPECT_DOUBLE_EQ(8.0, file[0].hours);
+}
+
+TEST(ServerRecordTests, TestLoadsLegacyFile)
+{
+    // Сырой файл версии 1 с удалённой записью посередине.
+    std::string name = "lab5_test_legacy_" + std::to_string(currentProcessId()) + ".bin";
+    {
+        employee raw[3] = { { 1, "Ann", 5.0 }, { TOMBSTONE_ID, "", 0.0 }, { 3, "Cid", 7.0 } };
+        std::ofstream out(name, std::ios::binary);
+        out.write((const char*)raw, sizeof(raw));
+    }
+
+    ServerProcess server({}, name);
+    DWORD a = ServerProcess::clientPid(1);
+
+    Request read = makeRequest(a, CMD_VALIDATE, 1);
+    read.version = NO_VERSION;
+    Response resp = server.request(read);
+    ASSERT_TRUE(resp.ok);
+    EXPECT_STREQ("Ann", resp.data.name);
+    EXPECT_EQ(ST_NOT_FOUND, server.request(a, CMD_VALIDATE, 2).status);
+
+    // Новая запись занимает слот удалённой.
+    ASSERT_TRUE(insertRecord(server, a, employee{ 4, "Dan", 8.0 }).ok);
+    ASSERT_TRUE(server.stop());
+
+    std::vector<employee> file;
+    ASSERT_EQ(RF_OK, readRecordFile(name, file));
+    ASSERT_EQ(3u, file.size());
+    EXPECT_EQ(1, file[0].num);
+    EXPECT_EQ(4, file[1].num);
+    EXPECT_EQ(3, file[2].num);
+}
+
+TEST(ServerRecordTests, TestReaderUsesOwnServerRegion)
+{
+    ServerProcess alpha({ employee{ 1, "Alpha", 1 } });
+    ServerProcess bravo({ employee{ 1, "Bravo", 2 } });
+
+    CachedReader reader(ServerProcess::clientPid(1), 16, alpha.name);
+    employee e{};
+    ASSERT_TRUE(reader.read(1, e));
+    EXPECT_STREQ("Alpha", e.name);
+}
+
+static void updateRecord(const ServerProcess& server, DWORD pid, const employee& e)
+{
+    ASSERT_TRUE(server.request(pid, CMD_WRITE_REQUEST, e.num).ok);
+    Request submit = makeRequest(pid, CMD_WRITE_SUBMIT, e.num);
+    submit.data = e;
+    ASSERT_TRUE(server.request(submit).ok);
+    ASSERT_TRUE(server.request(pid, CMD_FINISH_ACCESS, e.num).ok);
+}
+
+TEST(ServerSubscriptionTests, TestHeartbeatKeepsSubscriptionAlive)
+{
+    ServerProcess server({ employee{ 1, "Ann", 5 } });
+    DWORD pid = ServerProcess::clientPid(1);
+
+    EventListener listener;
+    std::atomic<int> batches(0);
+    ASSERT_TRUE(listener.start(pid, [&](const std::vector<ChangeEvent>&, bool) { batches++; }));
+    Response resp = server.request(pid, CMD_SUBSCRIBE, 1);
+    ASSERT_TRUE(resp.ok);
+    EXPECT_NE(0u, resp.epoch);
+
+    // Изменений нет, но пульс приходит; обработчик его не видит.
+    sleepMs(SUBSCRIPTION_HEARTBEAT_MS + 500);
+    EXPECT_LT(std::chrono::steady_clock::now() - listener.lastHeard(),
+        std::chrono::milliseconds(SUBSCRIPTION_HEARTBEAT_MS));
+    EXPECT_EQ(resp.epoch, listener.epoch());
+    EXPECT_EQ(0, batches.load());
+    listener.stop();
+}
+
+TEST(ServerSubscriptionTests, TestCacheDroppedAfterServerRestart)
+{
+    DWORD a = ServerProcess::clientPid(1);
+    ServerProcess first({ employee{ 1, "Ann", 5 } });
+    CachedReader reader(ServerProcess::clientPid(2), 16, first.name);
+    ASSERT_TRUE(reader.subscribe(1, 1));
+    updateRecord(first, a, employee{ 1, "Bob", 6 });
+
+    employee e{};
+    std::uint32_t version = 0;
+    ASSERT_TRUE(reader.read(1, e, &version));
+    EXPECT_STREQ("Bob", e.name);
+    ASSERT_TRUE(first.stop());
+
+    // Перезапущенный сервер не знает о подписке, а версии начинает заново.
+    ServerProcess second({}, first.file, "", first.name);
+    updateRecord(second, a, employee{ 1, "Cid", 7 });
+    sleepMs(SUBSCRIPTION_SILENCE_MS + 500);
+
+    ASSERT_TRUE(reader.read(1, e));
+    EXPECT_STREQ("Cid", e.name);
+    reader.stop();
+}
+
+TEST(ServerReplicationTests, TestFailedPromotionKeepsStandby)
+{
+    ServerProcess primary({ employee{ 1, "Ann", 5 } });
+    ServerProcess standby({ employee{ 1, "Ann", 5 } }, "", "--replica-of " + primary.name);
+    DWORD a = ServerProcess::clientPid(1);
+
+    // Основной жив и держит свой канал — повышение не удаётся, и резервный
+    // по-прежнему не принимает изменений.
+    EXPECT_FALSE(standby.request(a, CMD_PROMOTE, 0).ok);
+    Response resp = insertRecord(standby, a, employee{ 2, "Bob", 6 });
+    EXPECT_FALSE(resp.ok);
+    EXPECT_EQ(ST_READ_ONLY, resp.status);
+    EXPECT_TRUE(insertRecord(primary, a, employee{ 2, "Bob", 6 }).ok);
+}
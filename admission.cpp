@@ -0,0 +1,79 @@
+﻿#include "admission.h"
+
+using namespace std;
+
+// Раз в столько миллисекунд из таблицы убираются простаивающие клиенты.
+static const int PRUNE_INTERVAL_MS = 1000;
+
+static bool alwaysAdmitted(CommandType cmd) {
+    return cmd == CMD_FINISH_ACCESS || cmd == CMD_UNSUBSCRIBE
+        || cmd == CMD_EXIT || cmd == CMD_PROMOTE;
+}
+
+AdmissionQueue::AdmissionQueue(const AdmissionLimits& l) : limits(l), queued(0) {}
+
+void AdmissionQueue::refill(SessionQueue& s, Clock::time_point now) {
+    double elapsed = chrono::duration<double>(now - s.refilled).count();
+    if (elapsed <= 0) return;
+
+    s.tokens += elapsed * limits.ratePerSecond;
+    if (s.tokens > limits.burst) s.tokens = limits.burst;
+    s.refilled = now;
+}
+
+// Клиент с пустой очередью и полным ведром ничем не отличается от нового.
+void AdmissionQueue::prune(Clock::time_point now) {
+    if (now - lastPrune < chrono::milliseconds(PRUNE_INTERVAL_MS)) return;
+    lastPrune = now;
+
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        refill(it->second, now);
+        if (it->second.requests.empty() && it->second.tokens >= limits.burst) {
+            it = sessions.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+Admission AdmissionQueue::push(const Request& req, Clock::time_point now) {
+    prune(now);
+
+    auto found = sessions.find(req.clientPid);
+    if (found == sessions.end()) {
+        found = sessions.emplace(req.clientPid, SessionQueue()).first;
+        found->second.tokens = limits.burst;
+        found->second.refilled = now;
+    }
+    SessionQueue& s = found->second;
+
+    if (!alwaysAdmitted(req.cmd)) {
+        if (queued >= limits.maxQueued && req.cmd != CMD_LOCK_DUMP) return ADMIT_OVERLOADED;
+        if (s.requests.size() >= limits.sessionQueue) return ADMIT_SESSION_FULL;
+
+        refill(s, now);
+        if (s.tokens < 1.0) return ADMIT_RATE_LIMITED;
+        s.tokens -= 1.0;
+    }
+
+    if (s.requests.empty()) ready.push_back(req.clientPid);
+    s.requests.push_back(req);
+    queued++;
+    return ADMIT_OK;
+}
+
+bool AdmissionQueue::pop(Request& req) {
+    if (ready.empty()) return false;
+
+    DWORD pid = ready.front();
+    ready.pop_front();
+
+    SessionQueue& s = sessions[pid];
+    req = s.requests.front();
+    s.requests.pop_front();
+    queued--;
+
+    if (!s.requests.empty()) ready.push_back(pid);
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include "employee.h"
+#include "ring_buffer.h"
+
+// Ограничения приёма запросов. Каждый клиент получает ведро жетонов:
+// ratePerSecond жетонов в секунду, не больше burst про запас.
+struct AdmissionLimits {
+    size_t maxQueued;       // всего запросов в очередях сервера
+    size_t sessionQueue;    // запросов в очереди одного клиента
+    double ratePerSecond;
+    double burst;
+
+    AdmissionLimits() : maxQueued(1024), sessionQueue(32), ratePerSecond(200.0), burst(50.0) {}
+};
+
+enum Admission {
+    ADMIT_OK,
+    ADMIT_RATE_LIMITED,
+    ADMIT_SESSION_FULL,
+    ADMIT_OVERLOADED
+};
+
+// Очереди входящих запросов по клиентам. Запросы одного клиента выдаются
+// в порядке поступления, клиенты обслуживаются по кругу, поэтому клиент,
+// заваливший сервер запросами, не задерживает остальных. Запрос сверх
+// ограничений не ставится в очередь — на него сразу отвечают отказом.
+// Снятие блокировки и завершение работы принимаются всегда: отказ в них
+// оставил бы запись занятой. Таблица блокировок не упирается в общий предел
+// очередей — она нужна как раз тогда, когда сервер стоит, — но проходит
+// через очередь и ведро жетонов своего клиента.
+// Очередь не потокобезопасна, её защищает вызывающий.
+class AdmissionQueue {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit AdmissionQueue(const AdmissionLimits& limits = AdmissionLimits());
+
+    void setLimits(const AdmissionLimits& l) { limits = l; }
+    const AdmissionLimits& currentLimits() const { return limits; }
+
+    Admission push(const Request& req, Clock::time_point now);
+    bool pop(Request& req);
+
+    bool empty() const { return queued == 0; }
+    size_t size() const { return queued; }
+    size_t sessionCount() const { return sessions.size(); }
+
+private:
+    struct SessionQueue {
+        RingBuffer<Request> requests;
+        double tokens;
+        Clock::time_point refilled;
+
+        SessionQueue() : requests(4), tokens(0.0) {}
+    };
+
+    void refill(SessionQueue& s, Clock::time_point now);
+    void prune(Clock::time_point now);
+
+    AdmissionLimits limits;
+    std::map<DWORD, SessionQueue> sessions;
+    std::deque<DWORD> ready;
+    size_t queued;
+    Clock::time_point lastPrune;
+};
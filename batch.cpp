@@ -0,0 +1,215 @@
+﻿#include "batch.h"
+#include <cstring>
+#include <set>
+#include <sstream>
+#include "platform.h"
+
+using namespace std;
+
+// В окне запросов меньше, чем вмещает очередь клиента на сервере (admission.h).
+static const size_t BATCH_WINDOW_REQUESTS = 24;
+static const int BATCH_MAX_ATTEMPTS = 6;
+static const unsigned BATCH_RETRY_MS = 5;
+
+ParseResult parseBatchLine(const string& text, BatchOp& op) {
+    istringstream in(text);
+    string word;
+    if (!(in >> word) || word[0] == '#') return PARSE_SKIP;
+
+    op = BatchOp{};
+    if (word == "read") op.type = OP_READ;
+    else if (word == "update") op.type = OP_UPDATE;
+    else if (word == "insert") op.type = OP_INSERT;
+    else if (word == "delete") op.type = OP_DELETE;
+    else return PARSE_ERROR;
+
+    if (!(in >> op.id) || op.id == TOMBSTONE_ID) return PARSE_ERROR;
+    op.data.num = op.id;
+
+    if (op.type == OP_UPDATE || op.type == OP_INSERT) {
+        string name;
+        if (!(in >> name >> op.data.hours) || name.size() >= sizeof(op.data.name)) {
+            return PARSE_ERROR;
+        }
+        strcpy(op.data.name, name.c_str());
+    }
+
+    string extra;
+    if (in >> extra) return PARSE_ERROR;
+    return PARSE_OK;
+}
+
+size_t batchRequestCount(const BatchOp& op) {
+    return op.type == OP_UPDATE ? 3 : 1;
+}
+
+void appendBatchRequests(const BatchOp& op, vector<Request>& requests) {
+    Request req{};
+    req.id = op.id;
+    req.data = op.data;
+
+    switch (op.type) {
+    case OP_READ:
+        req.cmd = CMD_VALIDATE;
+        req.version = NO_VERSION;
+        requests.push_back(req);
+        break;
+    case OP_UPDATE:
+        req.cmd = CMD_WRITE_REQUEST;
+        requests.push_back(req);
+        req.cmd = CMD_WRITE_SUBMIT;
+        requests.push_back(req);
+        req.cmd = CMD_FINISH_ACCESS;
+        requests.push_back(req);
+        break;
+    case OP_INSERT:
+        req.cmd = CMD_INSERT;
+        requests.push_back(req);
+        break;
+    case OP_DELETE:
+        req.cmd = CMD_DELETE;
+        requests.push_back(req);
+        break;
+    }
+}
+
+BatchResult batchResult(const BatchOp& op, const Response* responses) {
+    // У изменения решают блокировка и сохранение; снятие блокировки успешно всегда.
+    const Response* decisive = &responses[0];
+    if (op.type == OP_UPDATE && responses[0].ok) decisive = &responses[1];
+
+    BatchResult result{};
+    result.ok = decisive->ok;
+    result.status = decisive->ok ? ST_OK : decisive->status;
+    result.version = decisive->version;
+    result.data = op.type == OP_READ ? decisive->data : op.data;
+    return result;
+}
+
+const char* batchStatusName(ResponseStatus status) {
+    switch (status) {
+    case ST_OK: return "ok";
+    case ST_NOT_FOUND: return "not_found";
+    case ST_BUSY: return "busy";
+    case ST_TIMEOUT: return "timeout";
+    case ST_NOT_MODIFIED: return "not_modified";
+    case ST_EXISTS: return "exists";
+    case ST_READ_ONLY: return "read_only";
+    case ST_OVERLOADED: return "overloaded";
+    }
+    return "error";
+}
+
+string formatBatchResult(const BatchOp& op, const BatchResult& result) {
+    static const char* const names[] = { "read", "update", "insert", "delete" };
+
+    ostringstream line;
+    line << op.line << '\t' << names[op.type] << '\t' << op.id << '\t'
+        << batchStatusName(result.status) << '\t';
+    if (result.ok && op.type != OP_DELETE) {
+        line << result.version << '\t' << result.data.name << '\t' << result.data.hours;
+    }
+    else if (result.ok) {
+        line << result.version << "\t-\t-";
+    }
+    else {
+        line << "-\t-\t-";
+    }
+    return line.str();
+}
+
+static bool retryable(const BatchResult& result) {
+    return !result.ok && (result.status == ST_BUSY || result.status == ST_OVERLOADED);
+}
+
+vector<size_t> batchRetries(const vector<BatchOp>& ops, const vector<size_t>& pending,
+    const vector<BatchResult>& results, bool lastAttempt) {
+    vector<size_t> retry;
+    // Записи, у которых более поздняя операция уже выполнена окончательно.
+    set<int> settled;
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+        size_t i = *it;
+        if (!lastAttempt && retryable(results[i]) && settled.count(ops[i].id) == 0) {
+            retry.push_back(i);
+        }
+        else {
+            settled.insert(ops[i].id);
+        }
+    }
+    return vector<size_t>(retry.rbegin(), retry.rend());
+}
+
+static bool runWindow(const vector<BatchOp>& ops, vector<BatchResult>& results,
+    RequestPipeline& pipeline) {
+    results.assign(ops.size(), BatchResult{});
+
+    vector<size_t> pending;
+    for (size_t i = 0; i < ops.size(); i++) pending.push_back(i);
+
+    vector<Request> requests;
+    vector<Response> responses;
+    for (int attempt = 0; !pending.empty(); attempt++) {
+        if (attempt > 0) sleepMs(BATCH_RETRY_MS << (attempt - 1));
+
+        requests.clear();
+        for (size_t i : pending) appendBatchRequests(ops[i], requests);
+        if (!pipeline.exchange(requests, responses)) return false;
+
+        size_t at = 0;
+        for (size_t i : pending) {
+            results[i] = batchResult(ops[i], &responses[at]);
+            at += batchRequestCount(ops[i]);
+        }
+        pending = batchRetries(ops, pending, results, attempt + 1 >= BATCH_MAX_ATTEMPTS);
+    }
+    return true;
+}
+
+bool runBatch(istream& in, ostream& out, RequestPipeline& pipeline, BatchStats& stats) {
+    stats = BatchStats{ 0, 0 };
+
+    vector<BatchOp> window;
+    vector<BatchResult> results;
+    string text;
+    int line = 0;
+    bool more = true;
+    while (more) {
+        window.clear();
+        size_t requestCount = 0;
+        // Окно обрывается на ошибочной строке, чтобы строки результата
+        // шли в порядке сценария.
+        int syntaxError = 0;
+        while (requestCount < BATCH_WINDOW_REQUESTS && syntaxError == 0) {
+            if (!getline(in, text)) {
+                more = false;
+                break;
+            }
+            line++;
+
+            BatchOp op;
+            ParseResult parsed = parseBatchLine(text, op);
+            if (parsed == PARSE_SKIP) continue;
+            if (parsed == PARSE_ERROR) {
+                syntaxError = line;
+                continue;
+            }
+            op.line = line;
+            window.push_back(op);
+            requestCount += batchRequestCount(op);
+        }
+        if (!window.empty()) {
+            if (!runWindow(window, results, pipeline)) return false;
+            for (size_t i = 0; i < window.size(); i++) {
+                out << formatBatchResult(window[i], results[i]) << '\n';
+                if (results[i].ok) stats.ok++;
+                else stats.failed++;
+            }
+        }
+        if (syntaxError != 0) {
+            out << syntaxError << "\t-\t-\tsyntax\t-\t-\t-\n";
+            stats.failed++;
+        }
+        out.flush();
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "client_api.h"
+#include "employee.h"
+
+// Пакетный режим клиента. Сценарий — по одной операции в строке:
+//   read <id>
+//   update <id> <имя> <часы>
+//   insert <id> <имя> <часы>
+//   delete <id>
+// Пустые строки и строки с # пропускаются.
+// Результат — строка на операцию, поля через табуляцию:
+//   <номер строки> <операция> <id> <статус> <версия> <имя> <часы>
+
+enum BatchOpType {
+    OP_READ,
+    OP_UPDATE,
+    OP_INSERT,
+    OP_DELETE
+};
+
+struct BatchOp {
+    BatchOpType type;
+    int id;
+    employee data;
+    int line;
+};
+
+enum ParseResult {
+    PARSE_OK,
+    PARSE_SKIP,
+    PARSE_ERROR
+};
+
+ParseResult parseBatchLine(const std::string& text, BatchOp& op);
+
+// Запросы одной операции. Изменение — блокировка записи, новые данные и
+// снятие блокировки подряд, без ожидания: блокировка держится, пока сервер
+// обрабатывает эти три запроса.
+void appendBatchRequests(const BatchOp& op, std::vector<Request>& requests);
+size_t batchRequestCount(const BatchOp& op);
+
+struct BatchResult {
+    bool ok;
+    ResponseStatus status;
+    std::uint32_t version;
+    employee data;
+};
+
+// Итог операции по ответам на её запросы (responses — первый из них).
+BatchResult batchResult(const BatchOp& op, const Response* responses);
+
+// Какие из отправленных операций pending повторить. Операция не
+// повторяется, если более поздняя операция над той же записью уже
+// выполнена: повтор переставил бы их относительно сценария. Повторяемые
+// операции над одной записью уходят снова вместе и в прежнем порядке.
+std::vector<size_t> batchRetries(const std::vector<BatchOp>& ops, const std::vector<size_t>& pending,
+    const std::vector<BatchResult>& results, bool lastAttempt);
+
+const char* batchStatusName(ResponseStatus status);
+std::string formatBatchResult(const BatchOp& op, const BatchResult& result);
+
+struct BatchStats {
+    size_t ok;
+    size_t failed;
+};
+
+// Выполняет сценарий из in окнами по несколько операций; операции, которым
+// отказали из-за занятости записи или нагрузки, повторяются с паузой.
+// false — потеряна связь с сервером.
+bool runBatch(std::istream& in, std::ostream& out, RequestPipeline& pipeline, BatchStats& stats);
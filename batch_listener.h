@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "employee.h"
+#include "platform.h"
+
+// Приём пачек событий в отдельном потоке: каждое подключение к каналу несёт
+// заголовок Batch (с полем count), за ним count событий ChangeEvent.
+// Общая часть EventListener и ReplicationSink. Обработчик вызывается из
+// потока приёмника на каждую пачку, в том числе пустую (пульс), после
+// обновления lastHeard. Пачка с count больше maxEvents отбрасывается.
+template <typename Batch>
+class BatchListener {
+public:
+    typedef std::function<void(const Batch&, const std::vector<ChangeEvent>&)> Handler;
+
+    explicit BatchListener(std::uint32_t maxEvents) : maxEvents(maxEvents), running(false), heard(0) {}
+    ~BatchListener() { stop(); }
+
+    bool start(const std::string& pipeName, Handler h) {
+        if (running) return true;
+
+        name = pipeName;
+        handler = h;
+        if (!listener.listen(name)) return false;
+
+        heard = std::chrono::steady_clock::now().time_since_epoch().count();
+        running = true;
+        worker = std::thread(&BatchListener::run, this);
+        return true;
+    }
+
+    void stop() {
+        if (!running) return;
+
+        running = false;
+        // Поток приёмника заблокирован в accept; будим его пустым подключением.
+        ipc::Connection wake;
+        ipc::connect(name, wake);
+        wake.close();
+
+        worker.join();
+        listener.close();
+    }
+
+    bool isRunning() const { return running; }
+
+    std::chrono::steady_clock::time_point lastHeard() const {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(heard.load()));
+    }
+
+private:
+    void run() {
+        std::vector<ChangeEvent> events;
+        while (running) {
+            ipc::Connection conn;
+            if (!listener.accept(conn)) {
+                sleepMs(10);
+                continue;
+            }
+            if (!running) break;
+
+            Batch batch;
+            if (!conn.recvAll(&batch, sizeof(batch)) || batch.count > maxEvents) continue;
+
+            events.resize(batch.count);
+            if (batch.count > 0 && !conn.recvAll(events.data(), batch.count * sizeof(ChangeEvent))) continue;
+
+            heard = std::chrono::steady_clock::now().time_since_epoch().count();
+            handler(batch, events);
+        }
+    }
+
+    std::uint32_t maxEvents;
+    std::string name;
+    Handler handler;
+    ipc::Listener listener;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<std::chrono::steady_clock::rep> heard;
+};
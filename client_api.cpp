@@ -0,0 +1,280 @@
+﻿#include "client_api.h"
+#include <iostream>
+
+using namespace std;
+
+// Отправляет запрос и принимает подключение с ответом; продолжение ответа,
+// если оно есть, читается из conn.
+static bool exchangeRequest(const Request& req, Response& resp, const string& server,
+    ipc::Listener& responsePipe, ipc::Connection& conn) {
+    if (!responsePipe.listen(clientPipeName(req.clientPid))) {
+        cout << "Ошибка создания клиентского канала\n";
+        return false;
+    }
+
+    ipc::Connection serverPipe;
+    if (!ipc::connect(server, serverPipe)) {
+        cout << "Сервер не запущен!\n";
+        return false;
+    }
+
+    if (!serverPipe.sendAll(&req, sizeof(req))) {
+        cout << "Ошибка отправки запроса\n";
+        return false;
+    }
+    serverPipe.close();
+
+    if (!responsePipe.accept(conn) || !conn.recvAll(&resp, sizeof(resp))) {
+        cout << "Ошибка чтения ответа\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool sendRequest(const Request& req, Response& resp, const string& server) {
+    try {
+        ipc::Listener responsePipe;
+        ipc::Connection conn;
+        return exchangeRequest(req, resp, server, responsePipe, conn);
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при отправке запроса: " << e.what() << endl;
+        return false;
+    }
+}
+
+bool requestLockDump(DWORD pid, int holdThresholdMs, LockDumpHeader& header,
+    vector<LockDumpEntry>& entries, const string& server) {
+    try {
+        Request req{};
+        req.cmd = CMD_LOCK_DUMP;
+        req.clientPid = pid;
+        req.waitMs = holdThresholdMs;
+
+        ipc::Listener responsePipe;
+        ipc::Connection conn;
+        Response resp;
+        if (!exchangeRequest(req, resp, server, responsePipe, conn)) return false;
+        entries.clear();
+        if (!resp.ok || !conn.recvAll(&header, sizeof(header))) {
+            cout << "Ошибка чтения таблицы блокировок\n";
+            return false;
+        }
+        entries.resize(header.count);
+        if (header.count != 0
+            && !conn.recvAll(entries.data(), entries.size() * sizeof(LockDumpEntry))) {
+            cout << "Ошибка чтения таблицы блокировок\n";
+            return false;
+        }
+        return true;
+    }
+    catch (const exception& e) {
+        cout << "Ошибка при запросе таблицы блокировок: " << e.what() << endl;
+        return false;
+    }
+}
+
+RequestPipeline::RequestPipeline(DWORD clientPid, const string& serverName)
+    : pid(clientPid), server(serverName), nextSeq(1) {}
+
+// Сообщения конвейера идут в stderr: stdout пакетного клиента разбирают программы.
+bool RequestPipeline::open() {
+    if (!responsePipe.listen(clientPipeName(pid))) {
+        cerr << "Ошибка создания клиентского канала\n";
+        return false;
+    }
+    return true;
+}
+
+void RequestPipeline::close() {
+    responsePipe.close();
+}
+
+bool RequestPipeline::exchange(vector<Request>& requests, vector<Response>& responses) {
+    responses.assign(requests.size(), Response{});
+    if (requests.empty()) return true;
+
+    uint32_t first = nextSeq;
+    nextSeq += (uint32_t)requests.size();
+    for (size_t i = 0; i < requests.size(); i++) {
+        requests[i].clientPid = pid;
+        requests[i].seq = first + (uint32_t)i;
+    }
+
+    ipc::Connection serverPipe;
+    if (!ipc::connect(server, serverPipe)) {
+        cerr << "Сервер не запущен!\n";
+        return false;
+    }
+    if (!serverPipe.sendAll(requests.data(), requests.size() * sizeof(Request))) {
+        cerr << "Ошибка отправки запроса\n";
+        return false;
+    }
+    serverPipe.close();
+
+    // Ответы на отклонённые запросы приходят раньше остальных, поэтому
+    // порядок ответов не совпадает с порядком запросов.
+    size_t received = 0;
+    while (received < requests.size()) {
+        ipc::Connection conn;
+        Response resp;
+        if (!responsePipe.accept(conn) || !conn.recvAll(&resp, sizeof(resp))) {
+            cerr << "Ошибка чтения ответа\n";
+            return false;
+        }
+        // Запоздалый ответ на запрос прежнего окна пропускается.
+        uint32_t index = resp.seq - first;
+        if (index >= requests.size()) continue;
+
+        responses[index] = resp;
+        received++;
+    }
+    return true;
+}
+
+// Так часто читатель проверяет, что сервер, чья разделяемая память
+// открыта, ещё работает.
+static const int SHARED_CHECK_MS = 1000;
+
+CachedReader::CachedReader(DWORD clientPid, size_t capacity, const string& serverName)
+    : pid(clientPid), server(serverName), records(capacity) {}
+
+bool CachedReader::subscribe(int from, int to, EventListener::Handler onEvents) {
+    if (to < from) to = from;
+    if (onEvents) userHandler = onEvents;
+
+    bool started = listener.start(pid, [this](const vector<ChangeEvent>& events, bool overflow) {
+        records.setEpoch(listener.epoch());
+        records.apply(events, overflow);
+        if (userHandler) userHandler(events, overflow);
+    });
+    if (!started) return false;
+    if (!sendSubscribe(from, to)) return false;
+
+    lock_guard<mutex> guard(rangesMutex);
+    ranges.push_back(make_pair(from, to));
+    return true;
+}
+
+bool CachedReader::sendSubscribe(int from, int to) {
+    Request req{};
+    req.cmd = CMD_SUBSCRIBE;
+    req.id = from;
+    req.rangeEnd = to;
+    req.clientPid = pid;
+
+    Response resp;
+    if (!sendRequest(req, resp, server) || !resp.ok) return false;
+    records.setEpoch(resp.epoch);
+
+    // Что попало в кэш до подписки, могло устареть без уведомления.
+    records.invalidateRange(from, to);
+    return true;
+}
+
+void CachedReader::stop() {
+    listener.stop();
+    lock_guard<mutex> guard(rangesMutex);
+    ranges.clear();
+}
+
+bool CachedReader::subscriptionLive() const {
+    return chrono::steady_clock::now() - listener.lastHeard()
+        < chrono::milliseconds(SUBSCRIPTION_SILENCE_MS);
+}
+
+// Сервер удаляет подписчика, до которого не смог достучаться, и забывает
+// подписки при перезапуске — тогда пульс перестаёт приходить. Подписка
+// оформляется заново не чаще раза в SUBSCRIPTION_SILENCE_MS; до первого
+// пульса записи подписки читаются мимо кэша.
+void CachedReader::checkSubscription() {
+    if (!listener.isRunning() || subscriptionLive()) return;
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now < nextResubscribe) return;
+    nextResubscribe = now + chrono::milliseconds(SUBSCRIPTION_SILENCE_MS);
+
+    vector<pair<int, int>> current;
+    {
+        lock_guard<mutex> guard(rangesMutex);
+        current = ranges;
+    }
+    for (auto& r : current) {
+        sendSubscribe(r.first, r.second);
+    }
+}
+
+// Разделяемая память прежнего запуска сервера остаётся открытой у клиента:
+// она закрывается, когда эпоха сервера сменилась или её владелец
+// завершился, и открывается заново не чаще раза в SHARED_CHECK_MS.
+void CachedReader::checkShared() {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (shared.isOpen() && shared.epoch() != 0 && records.epoch() != 0
+        && shared.epoch() != records.epoch()) {
+        shared.close();
+        nextSharedCheck = now;
+    }
+    if (now < nextSharedCheck) return;
+    nextSharedCheck = now + chrono::milliseconds(SHARED_CHECK_MS);
+
+    if (shared.isOpen() && shared.ownerAlive()) return;
+    if (!shared.open(sharedStoreName(server))) return;
+    if (!shared.ownerAlive()) {
+        shared.close();
+        return;
+    }
+    records.setEpoch(shared.epoch());
+}
+
+bool CachedReader::isSubscribed(int id) {
+    if (!listener.isRunning() || !subscriptionLive()) return false;
+
+    lock_guard<mutex> guard(rangesMutex);
+    for (auto& r : ranges) {
+        if (id >= r.first && id <= r.second) return true;
+    }
+    return false;
+}
+
+bool CachedReader::read(int id, employee& out, uint32_t* version) {
+    checkSubscription();
+    if (isSubscribed(id) && records.get(id, out, version)) {
+        return true;
+    }
+    checkShared();
+    uint64_t generation = records.generation();
+
+    uint32_t v;
+    if (shared.isOpen() && shared.lookup(id, out, &v)) {
+        records.put(out, v, generation);
+        if (version) *version = v;
+        return true;
+    }
+
+    Request req{};
+    req.cmd = CMD_VALIDATE;
+    req.id = id;
+    req.clientPid = pid;
+    req.epoch = records.epoch();
+
+    employee cached;
+    if (!records.get(id, cached, &req.version)) {
+        req.version = NO_VERSION;
+    }
+
+    Response resp;
+    if (!sendRequest(req, resp, server)) return false;
+    // Сервер перезапустился: прежние версии несравнимы с новыми.
+    if (records.setEpoch(resp.epoch)) generation = records.generation();
+    if (!resp.ok) {
+        // Отказ из-за нагрузки ничего не говорит о самой записи.
+        if (resp.status == ST_NOT_FOUND) records.invalidate(id);
+        return false;
+    }
+
+    out = resp.status == ST_NOT_MODIFIED ? cached : resp.data;
+    records.put(out, resp.version, generation);
+    if (version) *version = resp.version;
+    return true;
+}
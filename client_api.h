@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "employee.h"
+#include "event_listener.h"
+#include "read_cache.h"
+#include "shared_store.h"
+
+// Версия, которой нет ни у одной записи: CMD_VALIDATE без данных в кэше.
+const std::uint32_t NO_VERSION = 0xFFFFFFFFu;
+
+// Отправляет запрос серверу server и ждёт ответ в канале clientPipeName(req.clientPid).
+bool sendRequest(const Request& req, Response& resp, const std::string& server = SERVER_PIPE_NAME);
+
+// Запрашивает таблицу блокировок (CMD_LOCK_DUMP); holdThresholdMs — порог
+// долгого удержания, 0 — порог сервера.
+bool requestLockDump(DWORD pid, int holdThresholdMs, LockDumpHeader& header,
+    std::vector<LockDumpEntry>& entries, const std::string& server = SERVER_PIPE_NAME);
+
+// Конвейер запросов для пакетной работы: канал ответов открыт всё время,
+// запросы окна уходят серверу одним подключением, ответы сопоставляются
+// с запросами по Request::seq.
+class RequestPipeline {
+public:
+    explicit RequestPipeline(DWORD pid, const std::string& server = SERVER_PIPE_NAME);
+
+    bool open();
+    void close();
+
+    // Отправляет запросы и ждёт ответ на каждый; responses[i] — ответ на requests[i].
+    bool exchange(std::vector<Request>& requests, std::vector<Response>& responses);
+
+private:
+    DWORD pid;
+    std::string server;
+    ipc::Listener responsePipe;
+    std::uint32_t nextSeq;
+};
+
+// Чтение записей без блокировки с кэшем на стороне клиента. Записи из
+// диапазонов, на которые оформлена подписка, отдаются из кэша: сервер сам
+// сообщает об их изменении. Остальные берутся из разделяемой памяти сервера
+// или проверяются одним запросом CMD_VALIDATE по версии из кэша.
+// Подписке верят, пока от сервера приходит пульс; потерянная подписка
+// оформляется заново, а её записи в кэше сбрасываются.
+class CachedReader {
+public:
+    explicit CachedReader(DWORD pid, size_t capacity = 256,
+        const std::string& server = SERVER_PIPE_NAME);
+
+    bool subscribe(int from, int to, EventListener::Handler onEvents = nullptr);
+    void stop();
+
+    bool read(int id, employee& out, std::uint32_t* version = nullptr);
+
+    ReadCache& cache() { return records; }
+
+private:
+    bool sendSubscribe(int from, int to);
+    bool subscriptionLive() const;
+    void checkSubscription();
+    void checkShared();
+    bool isSubscribed(int id);
+
+    DWORD pid;
+    std::string server;
+    ReadCache records;
+    EventListener listener;
+    EventListener::Handler userHandler;
+    SharedStore shared;
+    std::chrono::steady_clock::time_point nextSharedCheck;
+    std::chrono::steady_clock::time_point nextResubscribe;
+    std::vector<std::pair<int, int>> ranges;
+    std::mutex rangesMutex;
+};
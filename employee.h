@@ -1,28 +1,139 @@
-#pragma once
-#include <windows.h>
-
-struct employee {
-    int num;
-    char name[10];
-    double hours;
-};
-
-enum CommandType {
-    CMD_READ,
-    CMD_WRITE_REQUEST,
-    CMD_WRITE_SUBMIT,
-    CMD_FINISH_ACCESS,
-    CMD_EXIT
-};
-
-struct Request {
-    CommandType cmd;
-    int id;         
-    DWORD clientPid;
-    employee data;  
-};
-
-struct Response {
-    bool ok;
-    employee data;
-};
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <string>
+#include "platform.h"
+
+const char* const SERVER_PIPE_NAME = "server_pipe";
+
+inline std::string clientPipeName(DWORD pid) {
+    return "client_pipe_" + std::to_string(pid);
+}
+
+inline std::string clientEventsPipeName(DWORD pid) {
+    return "client_events_" + std::to_string(pid);
+}
+
+inline std::string replicaPipeName(DWORD pid) {
+    return "replica_" + std::to_string(pid);
+}
+
+struct employee {
+    int num;
+    char name[10];
+    double hours;
+};
+
+// Удалённая запись остаётся в файле, пока её слот не займёт новая запись
+// или пока файл не будет уплотнён; num у неё равен TOMBSTONE_ID.
+const int TOMBSTONE_ID = INT_MIN;
+
+enum CommandType {
+    CMD_READ,
+    CMD_WRITE_REQUEST,
+    CMD_WRITE_SUBMIT,
+    CMD_FINISH_ACCESS,
+    CMD_EXIT,
+    CMD_SUBSCRIBE,
+    CMD_UNSUBSCRIBE,
+    CMD_VALIDATE,
+    CMD_INSERT,
+    CMD_DELETE,
+    CMD_REPLICATE,  // резервный сервер с PID clientPid подключается к основному
+    CMD_PROMOTE,    // резервный сервер становится основным
+    CMD_LOCK_DUMP   // таблица блокировок; waitMs — порог долгого удержания, мс
+};
+
+enum ResponseStatus {
+    ST_OK,
+    ST_NOT_FOUND,
+    ST_BUSY,
+    ST_TIMEOUT,
+    ST_NOT_MODIFIED,
+    ST_EXISTS,
+    ST_READ_ONLY,   // резервный сервер не принимает изменений
+    ST_OVERLOADED   // запрос отклонён ограничением нагрузки, повторите позже
+};
+
+// Для CMD_READ и CMD_WRITE_REQUEST: 0 — ответить сразу, даже если запись занята;
+// больше нуля — ждать блокировку в очереди не дольше waitMs; -1 — ждать без срока.
+const int WAIT_FOREVER = -1;
+
+struct Request {
+    CommandType cmd;
+    int id;         
+    DWORD clientPid;
+    employee data;  
+    int waitMs;
+    int rangeEnd;   // CMD_SUBSCRIBE: подписка на ID из [id, rangeEnd]
+    std::uint32_t version;  // CMD_VALIDATE: версия записи в кэше клиента
+    std::uint32_t seq;      // номер запроса у клиента, возвращается в Response::seq
+    std::uint32_t epoch;    // CMD_VALIDATE: эпоха сервера, к которой относится version
+};
+
+// epoch — эпоха сервера: она меняется при каждом его запуске, а версии
+// записей после перезапуска начинаются заново, поэтому версии из разных
+// эпох несравнимы.
+struct Response {
+    bool ok;
+    employee data;
+    ResponseStatus status;
+    std::uint32_t version;
+    std::uint32_t seq;
+    std::uint32_t epoch;
+};
+
+// Уведомления об изменениях сервер отправляет в канал clientEventsPipeName(pid):
+// заголовок EventBatch, за ним count событий ChangeEvent. Несколько изменений
+// одной записи до доставки сливаются в одно. overflow означает, что часть
+// событий потеряна и подписчику нужно перечитать записи целиком. Пустая
+// пачка — пульс: подписка на сервере жива. epoch — как в Response.
+struct ChangeEvent {
+    int id;
+    std::uint32_t version;
+    employee data;
+    bool deleted;
+};
+
+struct EventBatch {
+    std::uint32_t count;
+    bool overflow;
+    std::uint32_t epoch;
+};
+
+// Поток изменений основного сервера резервному — в канал replicaPipeName(pid):
+// заголовок ReplicationBatch, за ним count событий ChangeEvent. lsn — номер
+// последнего зафиксированного изменения, вошедшего в пачку. Пачка с reset
+// содержит полное состояние: записей, которых в ней нет, на основном нет.
+struct ReplicationBatch {
+    std::uint64_t lsn;
+    std::uint32_t count;
+    bool reset;
+};
+
+// Ответ на CMD_LOCK_DUMP: за Response в том же подключении идут заголовок
+// LockDumpHeader и count строк LockDumpEntry — по строке на каждую
+// удерживаемую блокировку и на каждого ожидающего в очереди.
+enum LockDumpMode {
+    LOCK_HELD_READ,
+    LOCK_HELD_WRITE,
+    LOCK_WAIT_READ,
+    LOCK_WAIT_WRITE
+};
+
+struct LockDumpHeader {
+    std::uint32_t count;
+    std::uint32_t cycles;           // циклов ожидания (взаимных блокировок)
+    std::uint32_t longHolds;        // блокировок, удерживаемых дольше порога
+    std::uint32_t holdThresholdMs;
+};
+
+struct LockDumpEntry {
+    int id;
+    DWORD pid;
+    LockDumpMode mode;
+    std::uint32_t position;     // место в очереди ожидания, у держателей 0
+    std::uint32_t durationMs;   // сколько блокировка удерживается или ожидается
+    std::uint32_t cycle;        // номер цикла ожидания, 0 — вне цикла
+    bool longHold;
+};
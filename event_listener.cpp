@@ -0,0 +1,29 @@
+﻿#include "event_listener.h"
+
+using namespace std;
+
+// Пачка больше этого размера считается повреждённой.
+static const uint32_t MAX_BATCH_EVENTS = 65536;
+
+EventListener::EventListener() : batches(MAX_BATCH_EVENTS), serverEpoch(0) {}
+
+EventListener::~EventListener() {
+    stop();
+}
+
+bool EventListener::start(DWORD pid, Handler h) {
+    if (batches.isRunning()) return true;
+
+    handler = h;
+    return batches.start(clientEventsPipeName(pid),
+        [this](const EventBatch& batch, const vector<ChangeEvent>& events) { receive(batch, events); });
+}
+
+void EventListener::stop() {
+    batches.stop();
+}
+
+void EventListener::receive(const EventBatch& batch, const vector<ChangeEvent>& events) {
+    serverEpoch = batch.epoch;
+    if (batch.count > 0 || batch.overflow) handler(events, batch.overflow);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "batch_listener.h"
+#include "employee.h"
+
+// Без изменений сервер раз в SUBSCRIPTION_HEARTBEAT_MS шлёт подписчику
+// пустую пачку. Подписка, от которой нет ничего дольше
+// SUBSCRIPTION_SILENCE_MS, потеряна: сервер удалил подписчика, до которого
+// не достучался, или перезапустился.
+const unsigned SUBSCRIPTION_HEARTBEAT_MS = 1000;
+const unsigned SUBSCRIPTION_SILENCE_MS = SUBSCRIPTION_HEARTBEAT_MS * 3;
+
+// Принимает уведомления об изменениях записей в отдельном потоке и передаёт
+// каждую пачку обработчику. Обработчик вызывается из потока слушателя.
+// Пустые пачки (пульс сервера) обработчику не передаются, они только
+// обновляют lastHeard и epoch.
+class EventListener {
+public:
+    typedef std::function<void(const std::vector<ChangeEvent>&, bool overflow)> Handler;
+
+    EventListener();
+    ~EventListener();
+
+    bool start(DWORD pid, Handler handler);
+    void stop();
+    bool isRunning() const { return batches.isRunning(); }
+    std::chrono::steady_clock::time_point lastHeard() const { return batches.lastHeard(); }
+    // Эпоха сервера из последней пачки, 0 — пачек ещё не было.
+    std::uint32_t epoch() const { return serverEpoch; }
+
+private:
+    void receive(const EventBatch& batch, const std::vector<ChangeEvent>& events);
+
+    Handler handler;
+    BatchListener<EventBatch> batches;
+    std::atomic<std::uint32_t> serverEpoch;
+};
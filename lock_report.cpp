@@ -0,0 +1,125 @@
+﻿#include "lock_report.h"
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+bool isWaiting(LockDumpMode mode) {
+    return mode == LOCK_WAIT_READ || mode == LOCK_WAIT_WRITE;
+}
+
+static bool isWriter(LockDumpMode mode) {
+    return mode == LOCK_HELD_WRITE || mode == LOCK_WAIT_WRITE;
+}
+
+// Ждёт ли ожидающий w строку other той же записи.
+static bool blockedBy(const LockDumpEntry& w, const LockDumpEntry& other) {
+    if (&w == &other || w.id != other.id) return false;
+    if (!isWaiting(other.mode)) return isWriter(w.mode) || isWriter(other.mode);
+    return other.position < w.position && (isWriter(w.mode) || isWriter(other.mode));
+}
+
+namespace {
+
+// Компоненты сильной связности по Тарьяну. Граф маленький — по вершине
+// на клиента, — поэтому рекурсия допустима.
+struct CycleFinder {
+    map<DWORD, vector<DWORD>> edges;
+    map<DWORD, int> index;
+    map<DWORD, int> low;
+    map<DWORD, size_t> component;
+    vector<DWORD> stack;
+    map<DWORD, bool> onStack;
+    int nextIndex = 0;
+    size_t components = 0;
+
+    void visit(DWORD v) {
+        index[v] = low[v] = nextIndex++;
+        stack.push_back(v);
+        onStack[v] = true;
+
+        for (DWORD to : edges[v]) {
+            if (!index.count(to)) {
+                visit(to);
+                low[v] = min(low[v], low[to]);
+            }
+            else if (onStack[to]) {
+                low[v] = min(low[v], index[to]);
+            }
+        }
+
+        if (low[v] != index[v]) return;
+        components++;
+        DWORD top;
+        do {
+            top = stack.back();
+            stack.pop_back();
+            onStack[top] = false;
+            component[top] = components;
+        } while (top != v);
+    }
+};
+
+}
+
+size_t markWaitCycles(vector<LockDumpEntry>& entries) {
+    // Ждать можно только строк той же записи, поэтому рёбра ищутся внутри
+    // группы строк с одним ID, а не среди всей таблицы.
+    map<int, vector<size_t>> byId;
+    for (size_t i = 0; i < entries.size(); i++) {
+        byId[entries[i].id].push_back(i);
+    }
+
+    CycleFinder finder;
+    for (const LockDumpEntry& w : entries) {
+        if (!isWaiting(w.mode)) continue;
+        vector<DWORD>& out = finder.edges[w.pid];
+        for (size_t i : byId[w.id]) {
+            if (blockedBy(w, entries[i])) out.push_back(entries[i].pid);
+        }
+    }
+
+    for (auto& e : finder.edges) {
+        if (!finder.index.count(e.first)) finder.visit(e.first);
+    }
+
+    // Компонента — цикл, если в ней есть ребро внутри неё (в том числе петля).
+    map<size_t, uint32_t> cycleNumbers;
+    for (LockDumpEntry& w : entries) {
+        w.cycle = 0;
+        if (!isWaiting(w.mode)) continue;
+
+        size_t own = finder.component[w.pid];
+        for (size_t i : byId[w.id]) {
+            const LockDumpEntry& other = entries[i];
+            if (!blockedBy(w, other) || finder.component[other.pid] != own) continue;
+
+            auto number = cycleNumbers.find(own);
+            if (number == cycleNumbers.end()) {
+                number = cycleNumbers.emplace(own, (uint32_t)cycleNumbers.size() + 1).first;
+            }
+            w.cycle = number->second;
+            break;
+        }
+    }
+    return cycleNumbers.size();
+}
+
+size_t markLongHolds(vector<LockDumpEntry>& entries, uint32_t thresholdMs) {
+    size_t count = 0;
+    for (LockDumpEntry& e : entries) {
+        e.longHold = !isWaiting(e.mode) && e.durationMs >= thresholdMs;
+        if (e.longHold) count++;
+    }
+    return count;
+}
+
+const char* lockModeName(LockDumpMode mode) {
+    switch (mode) {
+    case LOCK_HELD_READ: return "чтение";
+    case LOCK_HELD_WRITE: return "запись";
+    case LOCK_WAIT_READ: return "ждёт чтения";
+    case LOCK_WAIT_WRITE: return "ждёт записи";
+    }
+    return "?";
+}
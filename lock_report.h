@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "employee.h"
+
+// Разбор таблицы блокировок (CMD_LOCK_DUMP).
+//
+// Граф ожидания: ожидающий клиент ждёт держателей записи, с которыми его
+// режим несовместим, и ожидающих впереди в очереди, если один из двоих
+// писатель (очередь обслуживается строго по порядку). Клиенты из одной
+// сильно связной компоненты графа — или клиент, ждущий сам себя, например
+// читатель, запросивший запись той же записи, — не дождутся друг друга:
+// их освободит только срок ожидания.
+
+bool isWaiting(LockDumpMode mode);
+
+// Проставляет номера циклов ожидающим строкам и возвращает число циклов.
+size_t markWaitCycles(std::vector<LockDumpEntry>& entries);
+
+// Отмечает держателей, удерживающих блокировку не меньше thresholdMs;
+// возвращает их число.
+size_t markLongHolds(std::vector<LockDumpEntry>& entries, std::uint32_t thresholdMs);
+
+const char* lockModeName(LockDumpMode mode);
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Пул объектов одного типа: память выделяется блоками по SlabSize объектов
+// и после release возвращается в список свободных, а не в кучу. Пока пул
+// не исчерпан, acquire не обращается к распределителю памяти.
+// Пул не потокобезопасен: им пользуется только главный поток сервера.
+template <typename T, size_t SlabSize = 64>
+class ObjectPool {
+public:
+    ObjectPool() : freeList(nullptr), used(0) {}
+
+    ~ObjectPool() {
+        for (Node* slab : slabs) {
+            delete[] slab;
+        }
+    }
+
+    template <typename... Args>
+    T* acquire(Args&&... args) {
+        if (!freeList) grow();
+
+        Node* node = freeList;
+        freeList = node->next;
+        used++;
+        return new (node->storage) T(std::forward<Args>(args)...);
+    }
+
+    void release(T* object) {
+        if (!object) return;
+
+        object->~T();
+        Node* node = reinterpret_cast<Node*>(object);
+        node->next = freeList;
+        freeList = node;
+        used--;
+    }
+
+    size_t inUse() const { return used; }
+    size_t capacity() const { return slabs.size() * SlabSize; }
+
+private:
+    union Node {
+        Node* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void grow() {
+        Node* slab = new Node[SlabSize];
+        slabs.push_back(slab);
+        for (size_t i = SlabSize; i > 0; i--) {
+            slab[i - 1].next = freeList;
+            freeList = &slab[i - 1];
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    std::vector<Node*> slabs;
+    Node* freeList;
+    size_t used;
+};
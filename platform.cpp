@@ -0,0 +1,554 @@
+﻿#include "platform.h"
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdio>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+DWORD currentProcessId() {
+    return GetCurrentProcessId();
+}
+
+bool processAlive(DWORD pid) {
+    HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (h == NULL) return GetLastError() == ERROR_ACCESS_DENIED;
+    bool alive = WaitForSingleObject(h, 0) == WAIT_TIMEOUT;
+    CloseHandle(h);
+    return alive;
+}
+
+int lastError() {
+    return (int)GetLastError();
+}
+
+void sleepMs(unsigned ms) {
+    Sleep(ms);
+}
+
+bool syncFile(const string& path) {
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    bool ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    return ok;
+}
+
+bool replaceFile(const string& from, const string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+SharedMemory::SharedMemory() : view(NULL), length(0), owner(false), mapping(NULL) {}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+bool SharedMemory::create(const string& name, size_t size) {
+    close();
+    path = "Local\\" + name;
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        (DWORD)((unsigned long long)size >> 32), (DWORD)size, path.c_str());
+    if (mapping == NULL) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        close();
+        return false;
+    }
+
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (view == NULL) {
+        close();
+        return false;
+    }
+    length = size;
+    owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const string& name, size_t size) {
+    close();
+    path = "Local\\" + name;
+    mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path.c_str());
+    if (mapping == NULL) return false;
+
+    view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    if (view == NULL) {
+        close();
+        return false;
+    }
+    length = size;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (view != NULL) {
+        UnmapViewOfFile(view);
+        view = NULL;
+    }
+    if (mapping != NULL) {
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+    length = 0;
+    owner = false;
+}
+
+bool SharedMemory::remove(const string&) {
+    return false;
+}
+
+namespace ipc {
+
+    static const DWORD PIPE_BUFFER_SIZE = 4096;
+
+    string endpointPath(const string& name) {
+        return "\\\\.\\pipe\\" + name;
+    }
+
+    // first — первый экземпляр: если канал с таким именем уже открыт
+    // другим процессом, создание не удаётся.
+    static HANDLE createInstance(const string& path, bool first) {
+        return CreateNamedPipeA(
+            path.c_str(),
+            PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+            PIPE_UNLIMITED_INSTANCES,
+            PIPE_BUFFER_SIZE,
+            PIPE_BUFFER_SIZE,
+            0,
+            NULL);
+    }
+
+    Connection::Connection() : handle(INVALID_HANDLE_VALUE), serverEnd(false) {}
+
+    Connection::~Connection() {
+        close();
+    }
+
+    Connection::Connection(Connection&& other) noexcept
+        : handle(other.handle), serverEnd(other.serverEnd) {
+        other.handle = INVALID_HANDLE_VALUE;
+    }
+
+    Connection& Connection::operator=(Connection&& other) noexcept {
+        if (this != &other) {
+            close();
+            handle = other.handle;
+            serverEnd = other.serverEnd;
+            other.handle = INVALID_HANDLE_VALUE;
+        }
+        return *this;
+    }
+
+    bool Connection::isOpen() const {
+        return handle != INVALID_HANDLE_VALUE;
+    }
+
+    bool Connection::sendAll(const void* data, size_t size) {
+        const char* p = (const char*)data;
+        while (size > 0) {
+            DWORD written;
+            if (!WriteFile(handle, p, (DWORD)size, &written, NULL)) return false;
+            p += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    bool Connection::recvAll(void* data, size_t size) {
+        char* p = (char*)data;
+        while (size > 0) {
+            DWORD bytesRead;
+            if (!ReadFile(handle, p, (DWORD)size, &bytesRead, NULL) || bytesRead == 0) return false;
+            p += bytesRead;
+            size -= bytesRead;
+        }
+        return true;
+    }
+
+    bool Connection::waitReadable(unsigned ms) {
+        for (unsigned waited = 0;; waited++) {
+            DWORD available = 0;
+            if (!PeekNamedPipe(handle, NULL, 0, NULL, &available, NULL) || available > 0) {
+                return true;
+            }
+            if (waited >= ms) return false;
+            Sleep(1);
+        }
+    }
+
+    void Connection::shutdown() {
+        if (handle == INVALID_HANDLE_VALUE) return;
+        CancelIoEx(handle, NULL);
+        if (serverEnd) DisconnectNamedPipe(handle);
+    }
+
+    void Connection::close() {
+        if (handle == INVALID_HANDLE_VALUE) return;
+        if (serverEnd) {
+            FlushFileBuffers(handle);
+            DisconnectNamedPipe(handle);
+        }
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+
+    Listener::Listener() : pending(INVALID_HANDLE_VALUE) {}
+
+    Listener::~Listener() {
+        close();
+    }
+
+    bool Listener::listen(const string& name) {
+        close();
+        path = endpointPath(name);
+        pending = createInstance(path, true);
+        return pending != INVALID_HANDLE_VALUE;
+    }
+
+    bool Listener::accept(Connection& conn) {
+        if (pending == INVALID_HANDLE_VALUE) {
+            pending = createInstance(path, false);
+            if (pending == INVALID_HANDLE_VALUE) return false;
+        }
+
+        if (!ConnectNamedPipe(pending, NULL) && GetLastError() != ERROR_PIPE_CONNECTED) {
+            CloseHandle(pending);
+            pending = INVALID_HANDLE_VALUE;
+            return false;
+        }
+
+        conn.close();
+        conn.handle = pending;
+        conn.serverEnd = true;
+        // Следующий экземпляр создаётся сразу, чтобы клиенты не получали
+        // ERROR_FILE_NOT_FOUND, пока текущий запрос обрабатывается.
+        pending = createInstance(path, false);
+        return true;
+    }
+
+    void Listener::close() {
+        if (pending != INVALID_HANDLE_VALUE) {
+            CloseHandle(pending);
+            pending = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    Endpoint::Endpoint() {}
+
+    Endpoint::Endpoint(const string& name) : fullPath(endpointPath(name)) {}
+
+    bool connect(const Endpoint& endpoint, Connection& conn) {
+        const string& path = endpoint.fullPath;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            HANDLE h = CreateFileA(
+                path.c_str(),
+                GENERIC_READ | GENERIC_WRITE,
+                0, NULL,
+                OPEN_EXISTING,
+                0, NULL);
+
+            if (h != INVALID_HANDLE_VALUE) {
+                conn.close();
+                conn.handle = h;
+                conn.serverEnd = false;
+                return true;
+            }
+            if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(path.c_str(), 1000)) {
+                return false;
+            }
+        }
+        return false;
+    }
+}
+
+#else
+
+DWORD currentProcessId() {
+    return (DWORD)getpid();
+}
+
+bool processAlive(DWORD pid) {
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+}
+
+int lastError() {
+    return errno;
+}
+
+void sleepMs(unsigned ms) {
+    timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+bool syncFile(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+bool replaceFile(const string& from, const string& to) {
+    return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+SharedMemory::SharedMemory() : view(NULL), length(0), owner(false) {}
+
+SharedMemory::~SharedMemory() {
+    close();
+}
+
+bool SharedMemory::create(const string& name, size_t size) {
+    close();
+    path = "/" + name;
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+    view = p;
+    length = size;
+    owner = true;
+    return true;
+}
+
+bool SharedMemory::open(const string& name, size_t size) {
+    close();
+    path = "/" + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+
+    view = p;
+    length = size;
+    return true;
+}
+
+void SharedMemory::close() {
+    if (view != NULL) {
+        munmap(view, length);
+        view = NULL;
+    }
+    if (owner) {
+        shm_unlink(path.c_str());
+    }
+    length = 0;
+    owner = false;
+}
+
+bool SharedMemory::remove(const string& name) {
+    return shm_unlink(("/" + name).c_str()) == 0;
+}
+
+namespace ipc {
+
+    string endpointPath(const string& name) {
+        return "/tmp/" + name + ".sock";
+    }
+
+    static bool makeAddress(const string& path, sockaddr_un& addr) {
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        addr = sockaddr_un{};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, path.size());
+        return true;
+    }
+
+    Connection::Connection() : fd(-1) {}
+
+    Connection::~Connection() {
+        close();
+    }
+
+    Connection::Connection(Connection&& other) noexcept : fd(other.fd) {
+        other.fd = -1;
+    }
+
+    Connection& Connection::operator=(Connection&& other) noexcept {
+        if (this != &other) {
+            close();
+            fd = other.fd;
+            other.fd = -1;
+        }
+        return *this;
+    }
+
+    bool Connection::isOpen() const {
+        return fd >= 0;
+    }
+
+    bool Connection::sendAll(const void* data, size_t size) {
+        const char* p = (const char*)data;
+        while (size > 0) {
+            ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            size -= (size_t)n;
+        }
+        return true;
+    }
+
+    bool Connection::recvAll(void* data, size_t size) {
+        char* p = (char*)data;
+        while (size > 0) {
+            ssize_t n = ::recv(fd, p, size, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= (size_t)n;
+        }
+        return true;
+    }
+
+    bool Connection::waitReadable(unsigned ms) {
+        pollfd p{};
+        p.fd = fd;
+        p.events = POLLIN;
+        int n;
+        do {
+            n = ::poll(&p, 1, (int)ms);
+        } while (n < 0 && errno == EINTR);
+        return n != 0;
+    }
+
+    void Connection::shutdown() {
+        if (fd < 0) return;
+        ::shutdown(fd, SHUT_RDWR);
+    }
+
+    void Connection::close() {
+        if (fd < 0) return;
+        ::close(fd);
+        fd = -1;
+    }
+
+    Listener::Listener() : fd(-1) {}
+
+    Listener::~Listener() {
+        close();
+    }
+
+    bool Listener::listen(const string& name) {
+        close();
+        path = endpointPath(name);
+
+        sockaddr_un addr;
+        if (!makeAddress(path, addr)) return false;
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+
+        // Сокет, оставшийся от аварийно завершённого процесса, мешает bind.
+        // Сокет, который ещё принимает подключения, принадлежит живому
+        // процессу — его удалять нельзя.
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool alive = probe >= 0 && ::connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+        if (probe >= 0) ::close(probe);
+        if (alive) {
+            ::close(fd);
+            fd = -1;
+            errno = EADDRINUSE;
+            return false;
+        }
+        ::unlink(path.c_str());
+        if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    bool Listener::accept(Connection& conn) {
+        if (fd < 0) return false;
+
+        int client;
+        do {
+            client = ::accept(fd, NULL, NULL);
+        } while (client < 0 && errno == EINTR);
+
+        if (client < 0) return false;
+
+        conn.close();
+        conn.fd = client;
+        return true;
+    }
+
+    void Listener::close() {
+        if (fd < 0) return;
+        ::close(fd);
+        ::unlink(path.c_str());
+        fd = -1;
+    }
+
+    Endpoint::Endpoint() : valid(false) {}
+
+    Endpoint::Endpoint(const string& name) : fullPath(endpointPath(name)) {
+        valid = makeAddress(fullPath, addr);
+    }
+
+    bool connect(const Endpoint& endpoint, Connection& conn) {
+        if (!endpoint.valid) return false;
+
+        int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (s < 0) return false;
+
+        if (::connect(s, (const sockaddr*)&endpoint.addr, sizeof(endpoint.addr)) != 0) {
+            ::close(s);
+            return false;
+        }
+
+        conn.close();
+        conn.fd = s;
+        return true;
+    }
+}
+
+#endif
+
+namespace ipc {
+
+    bool connect(const string& name, Connection& conn) {
+        return connect(Endpoint(name), conn);
+    }
+}
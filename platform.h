@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+// Иначе макросы min/max из windows.h ломают std::min, std::max и numeric_limits.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/un.h>
+typedef std::uint32_t DWORD;
+#endif
+
+DWORD currentProcessId();
+// Есть ли в системе процесс pid.
+bool processAlive(DWORD pid);
+int lastError();
+void sleepMs(unsigned ms);
+
+// Сбрасывает содержимое файла на диск (fsync / FlushFileBuffers).
+bool syncFile(const std::string& path);
+// Атомарно заменяет файл to файлом from.
+bool replaceFile(const std::string& from, const std::string& to);
+
+// Именованная область разделяемой памяти (CreateFileMapping / shm_open).
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    // Только новая область: false, если область name уже существует.
+    bool create(const std::string& name, size_t size);
+    bool open(const std::string& name, size_t size);
+    void close();
+    // Убирает имя области, оставшейся от завершившегося владельца.
+    // В Windows область исчезает сама, когда её закроют все процессы.
+    static bool remove(const std::string& name);
+
+    void* data() const { return view; }
+
+private:
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    void* view;
+    size_t length;
+    bool owner;
+    std::string path;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+namespace ipc {
+
+    // Именованная точка подключения: \\.\pipe\<name> в Windows,
+    // Unix-сокет в /tmp в POSIX.
+    std::string endpointPath(const std::string& name);
+
+    class Connection;
+
+    // Заранее вычисленный адрес точки подключения: повторные connect к нему
+    // не собирают строк и не выделяют память.
+    class Endpoint {
+    public:
+        Endpoint();
+        explicit Endpoint(const std::string& name);
+
+        const std::string& path() const { return fullPath; }
+
+    private:
+        friend bool connect(const Endpoint& endpoint, Connection& conn);
+
+        std::string fullPath;
+#ifndef _WIN32
+        sockaddr_un addr;
+        bool valid;
+#endif
+    };
+
+    class Connection {
+    public:
+        Connection();
+        ~Connection();
+        Connection(Connection&& other) noexcept;
+        Connection& operator=(Connection&& other) noexcept;
+
+        bool isOpen() const;
+        bool sendAll(const void* data, size_t size);
+        bool recvAll(void* data, size_t size);
+        // Ждёт до ms миллисекунд, пока recvAll сможет начать чтение без
+        // ожидания; закрытое подключение тоже считается готовым.
+        bool waitReadable(unsigned ms);
+        // Прерывает recvAll, заблокированный в другом потоке; само
+        // подключение закрывает его владелец.
+        void shutdown();
+        void close();
+
+    private:
+        friend class Listener;
+        friend bool connect(const Endpoint& endpoint, Connection& conn);
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+#ifdef _WIN32
+        HANDLE handle;
+        bool serverEnd;
+#else
+        int fd;
+#endif
+    };
+
+    class Listener {
+    public:
+        Listener();
+        ~Listener();
+
+        // false, если имя уже слушает другой процесс.
+        bool listen(const std::string& name);
+        bool accept(Connection& conn);
+        void close();
+
+    private:
+        Listener(const Listener&) = delete;
+        Listener& operator=(const Listener&) = delete;
+
+        std::string path;
+#ifdef _WIN32
+        HANDLE pending;
+#else
+        int fd;
+#endif
+    };
+
+    bool connect(const Endpoint& endpoint, Connection& conn);
+    bool connect(const std::string& name, Connection& conn);
+}
@@ -0,0 +1,146 @@
+﻿#include "read_cache.h"
+
+using namespace std;
+
+ReadCache::ReadCache(size_t cap) : capacity(cap == 0 ? 1 : cap), clears(0), currentEpoch(0) {}
+
+bool ReadCache::get(int id, employee& out, uint32_t* version) {
+    lock_guard<mutex> lock(guard);
+    auto it = index.find(id);
+    if (it == index.end()) return false;
+
+    entries.splice(entries.begin(), entries, it->second);
+    out = it->second->data;
+    if (version) *version = it->second->version;
+    return true;
+}
+
+void ReadCache::put(const employee& e, uint32_t version) {
+    lock_guard<mutex> lock(guard);
+    store(e, version);
+}
+
+void ReadCache::put(const employee& e, uint32_t version, uint64_t readGeneration) {
+    lock_guard<mutex> lock(guard);
+    if (clears != readGeneration) return;
+    store(e, version);
+}
+
+uint64_t ReadCache::generation() const {
+    lock_guard<mutex> lock(guard);
+    return clears;
+}
+
+bool ReadCache::setEpoch(uint32_t epoch) {
+    lock_guard<mutex> lock(guard);
+    if (epoch == 0 || epoch == currentEpoch) return false;
+
+    bool known = currentEpoch != 0;
+    currentEpoch = epoch;
+    if (!known) return false;
+    reset();
+    return true;
+}
+
+uint32_t ReadCache::epoch() const {
+    lock_guard<mutex> lock(guard);
+    return currentEpoch;
+}
+
+void ReadCache::store(const employee& e, uint32_t version) {
+    auto seen = notified.find(e.num);
+    if (seen != notified.end()) {
+        if (seen->second > version) return;
+        notified.erase(seen);
+    }
+
+    auto it = index.find(e.num);
+    if (it != index.end()) {
+        if (it->second->version > version) return;
+        it->second->data = e;
+        it->second->version = version;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().data.num);
+        entries.pop_back();
+    }
+    entries.push_front(Entry{ e, version });
+    index[e.num] = entries.begin();
+}
+
+void ReadCache::invalidate(int id) {
+    lock_guard<mutex> lock(guard);
+    auto it = index.find(id);
+    if (it == index.end()) return;
+
+    entries.erase(it->second);
+    index.erase(it);
+}
+
+void ReadCache::invalidateRange(int from, int to) {
+    lock_guard<mutex> lock(guard);
+    for (auto it = entries.begin(); it != entries.end();) {
+        int id = it->data.num;
+        if (id >= from && id <= to) {
+            index.erase(id);
+            it = entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void ReadCache::clear() {
+    lock_guard<mutex> lock(guard);
+    reset();
+}
+
+void ReadCache::reset() {
+    entries.clear();
+    index.clear();
+    notified.clear();
+    clears++;
+}
+
+// Уведомления обновляют только уже закэшированные записи: подписка может
+// покрывать намного больше ID, чем клиент реально читает. Для остальных
+// запоминается только версия, не больше capacity штук: при переполнении
+// запомненное забывается, а поколение меняется, и незавершённые чтения
+// не сохраняются, как после сброса.
+void ReadCache::apply(const vector<ChangeEvent>& events, bool overflow) {
+    if (overflow) {
+        clear();
+        return;
+    }
+
+    lock_guard<mutex> lock(guard);
+    for (auto& ev : events) {
+        auto it = index.find(ev.id);
+        if (it == index.end()) {
+            if (notified.size() >= capacity && notified.find(ev.id) == notified.end()) {
+                notified.clear();
+                clears++;
+            }
+            uint32_t& seen = notified[ev.id];
+            if (seen < ev.version) seen = ev.version;
+            continue;
+        }
+        if (it->second->version > ev.version) continue;
+        if (ev.deleted) {
+            entries.erase(it->second);
+            index.erase(it);
+            continue;
+        }
+        it->second->data = ev.data;
+        it->second->version = ev.version;
+    }
+}
+
+size_t ReadCache::size() const {
+    lock_guard<mutex> lock(guard);
+    return entries.size();
+}
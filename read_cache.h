@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "employee.h"
+
+// LRU-кэш записей на стороне клиента. Запись хранится вместе с версией,
+// под которой её отдал сервер; более старая версия не вытесняет более новую.
+// Обновляется и из потока уведомлений, поэтому защищён мьютексом.
+//
+// Уведомление может обогнать чтение, которое ещё не положило запись в кэш.
+// Поэтому для записей не из кэша запоминается версия последнего уведомления,
+// и более старое чтение не сохраняется. Сброс кэша меняет поколение
+// (generation); чтение, начатое до сброса, тоже не сохраняется.
+//
+// Версии сравнимы только в пределах одной эпохи сервера (Response::epoch):
+// новая эпоха сбрасывает кэш целиком.
+class ReadCache {
+public:
+    explicit ReadCache(size_t capacity = 256);
+
+    bool get(int id, employee& out, std::uint32_t* version = nullptr);
+    void put(const employee& e, std::uint32_t version);
+    // readGeneration — generation() до начала чтения записи.
+    void put(const employee& e, std::uint32_t version, std::uint64_t readGeneration);
+    std::uint64_t generation() const;
+    // true, если эпоха сменилась и кэш сброшен. Эпоха 0 ничего не меняет.
+    bool setEpoch(std::uint32_t epoch);
+    std::uint32_t epoch() const;
+    void invalidate(int id);
+    void invalidateRange(int from, int to);
+    void clear();
+    void apply(const std::vector<ChangeEvent>& events, bool overflow);
+
+    size_t size() const;
+
+private:
+    void store(const employee& e, std::uint32_t version);
+    void reset();
+
+    struct Entry {
+        employee data;
+        std::uint32_t version;
+    };
+
+    size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<int, std::list<Entry>::iterator> index;
+    std::unordered_map<int, std::uint32_t> notified;
+    std::uint64_t clears;
+    std::uint32_t currentEpoch;
+    mutable std::mutex guard;
+};
@@ -0,0 +1,179 @@
+﻿#include "record_format.h"
+#include <cstring>
+#include <fstream>
+#include "platform.h"
+
+using namespace std;
+
+static void putU16(unsigned char* out, uint16_t v) {
+    out[0] = (unsigned char)v;
+    out[1] = (unsigned char)(v >> 8);
+}
+
+static void putU32(unsigned char* out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void putU64(unsigned char* out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t getU16(const unsigned char* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getU32(const unsigned char* in) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | in[i];
+    return v;
+}
+
+static uint64_t getU64(const unsigned char* in) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | in[i];
+    return v;
+}
+
+void encodeHeader(const RecordFileHeader& header, unsigned char* out) {
+    putU32(out, header.magic);
+    putU16(out + 4, header.version);
+    putU16(out + 6, header.recordSize);
+    putU32(out + 8, header.count);
+    putU32(out + 12, header.checksum);
+}
+
+bool decodeHeader(const unsigned char* in, RecordFileHeader& header) {
+    header.magic = getU32(in);
+    header.version = getU16(in + 4);
+    header.recordSize = getU16(in + 6);
+    header.count = getU32(in + 8);
+    header.checksum = getU32(in + 12);
+    return header.magic == RECORD_FILE_MAGIC && header.version == RECORD_FILE_VERSION
+        && header.recordSize == RECORD_SIZE;
+}
+
+void encodeRecord(const employee& e, unsigned char* out) {
+    memset(out, 0, RECORD_SIZE);
+    putU32(out, (uint32_t)e.num);
+    memcpy(out + 4, e.name, sizeof(e.name));
+    uint64_t bits;
+    memcpy(&bits, &e.hours, sizeof(bits));
+    putU64(out + 16, bits);
+}
+
+employee decodeRecord(const unsigned char* in) {
+    employee e{};
+    e.num = (int)getU32(in);
+    memcpy(e.name, in + 4, sizeof(e.name));
+    e.name[sizeof(e.name) - 1] = '\0';
+    uint64_t bits = getU64(in + 16);
+    memcpy(&e.hours, &bits, sizeof(bits));
+    return e;
+}
+
+namespace {
+    struct ChecksumTable {
+        uint32_t values[256];
+
+        ChecksumTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                values[i] = c;
+            }
+        }
+    };
+}
+
+uint32_t updateChecksum(uint32_t crc, const unsigned char* data, size_t size) {
+    // Таблицей пользуются и главный поток, и поток контрольных точек.
+    static const ChecksumTable table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static RecordFileStatus readLegacy(ifstream& in, vector<employee>& records) {
+    // Сырой файл версии 1 состоит только из целых структур employee;
+    // обрывок в конце значит, что это не версия 1, а испорченный файл.
+    in.clear();
+    in.seekg(0, ios::end);
+    streamoff size = in.tellg();
+    if (size < 0 || size % (streamoff)sizeof(employee) != 0) return RF_CORRUPTED;
+
+    in.seekg(0);
+    employee e;
+    while (in.read((char*)&e, sizeof(e))) {
+        records.push_back(e);
+    }
+    return RF_LEGACY;
+}
+
+RecordFileStatus readRecordFile(const string& filename, vector<employee>& records) {
+    records.clear();
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) return RF_OPEN_FAILED;
+
+    unsigned char raw[RECORD_HEADER_SIZE];
+    RecordFileHeader header;
+    if (!in.read((char*)raw, sizeof(raw)) || getU32(raw) != RECORD_FILE_MAGIC) {
+        return readLegacy(in, records);
+    }
+    // Magic на месте, а версия или размер записи чужие: такой файл не версия 1,
+    // и читать его как сырые структуры нельзя.
+    if (!decodeHeader(raw, header)) return RF_CORRUPTED;
+
+    records.reserve(header.count);
+    uint32_t crc = 0;
+    unsigned char record[RECORD_SIZE];
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (!in.read((char*)record, sizeof(record))) return RF_CORRUPTED;
+        crc = updateChecksum(crc, record, sizeof(record));
+        records.push_back(decodeRecord(record));
+    }
+    if (crc != header.checksum) return RF_CORRUPTED;
+    return RF_OK;
+}
+
+bool writeRecordFile(const string& filename, const vector<employee>& records) {
+    string tmp = filename + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+
+        RecordFileHeader header{};
+        header.magic = RECORD_FILE_MAGIC;
+        header.version = RECORD_FILE_VERSION;
+        header.recordSize = (uint16_t)RECORD_SIZE;
+        header.count = (uint32_t)records.size();
+
+        unsigned char raw[RECORD_HEADER_SIZE];
+        encodeHeader(header, raw);
+        out.write((const char*)raw, sizeof(raw));
+
+        unsigned char record[RECORD_SIZE];
+        for (const employee& e : records) {
+            encodeRecord(e, record);
+            header.checksum = updateChecksum(header.checksum, record, sizeof(record));
+            out.write((const char*)record, sizeof(record));
+        }
+
+        encodeHeader(header, raw);
+        out.seekp(0);
+        out.write((const char*)raw, sizeof(raw));
+        out.close();
+        if (!out) return false;
+    }
+
+    return syncFile(tmp) && replaceFile(tmp, filename);
+}
+
+bool convertRecordFile(const string& from, const string& to) {
+    vector<employee> records;
+    RecordFileStatus status = readRecordFile(from, records);
+    if (status != RF_LEGACY && status != RF_OK) return false;
+    return writeRecordFile(to, records);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "employee.h"
+
+// Формат файла записей, версия 2:
+//   заголовок (RECORD_HEADER_SIZE байт): magic, версия формата, размер записи,
+//   число слотов, CRC32 всех записей;
+//   затем слоты по RECORD_SIZE байт.
+// Все числа хранятся в порядке little-endian с явными смещениями полей,
+// поэтому файл не зависит от выравнивания структур у компилятора.
+//   запись: num (0..3), name (4..13), резерв (14..15), hours (16..23).
+// Версия 1 — сырые структуры employee без заголовка; её умеет читать
+// readRecordFile и переводить convertRecordFile.
+const std::uint32_t RECORD_FILE_MAGIC = 0x4635424C;
+const std::uint16_t RECORD_FILE_VERSION = 2;
+const size_t RECORD_HEADER_SIZE = 16;
+const size_t RECORD_SIZE = 24;
+
+struct RecordFileHeader {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t recordSize;
+    std::uint32_t count;
+    std::uint32_t checksum;
+};
+
+void encodeHeader(const RecordFileHeader& header, unsigned char* out);
+bool decodeHeader(const unsigned char* in, RecordFileHeader& header);
+
+void encodeRecord(const employee& e, unsigned char* out);
+employee decodeRecord(const unsigned char* in);
+
+// Продолжает CRC32 (полином 0xEDB88320) по очередному блоку; начальное значение 0.
+std::uint32_t updateChecksum(std::uint32_t crc, const unsigned char* data, size_t size);
+
+// Смещение слота в файле версии 2.
+inline std::uint64_t recordOffset(size_t slot) {
+    return RECORD_HEADER_SIZE + (std::uint64_t)slot * RECORD_SIZE;
+}
+
+enum RecordFileStatus {
+    RF_OK,
+    RF_LEGACY,
+    RF_OPEN_FAILED,
+    RF_CORRUPTED
+};
+
+// Читает все слоты файла. Файл без magic версии 2, длина которого кратна
+// sizeof(employee), читается как сырой файл версии 1 (результат RF_LEGACY).
+// RF_CORRUPTED — при несовпадении контрольной суммы или размера, при чужой
+// версии или размере записи в заголовке с верным magic и при длине файла
+// без заголовка, не кратной sizeof(employee).
+RecordFileStatus readRecordFile(const std::string& filename, std::vector<employee>& records);
+
+// Пишет файл версии 2 целиком через временный файл и атомарную подмену.
+bool writeRecordFile(const std::string& filename, const std::vector<employee>& records);
+
+// Переводит сырой файл версии 1 в формат версии 2. from и to могут совпадать.
+bool convertRecordFile(const std::string& from, const std::string& to);
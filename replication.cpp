@@ -0,0 +1,145 @@
+﻿#include "replication.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+// Пачка с полным состоянием может быть большой, но не больше этого.
+static const uint32_t MAX_REPLICATION_EVENTS = 1u << 20;
+
+ReplicationSource::ReplicationSource(unsigned heartbeat) : heartbeatMs(heartbeat), stopping(false) {}
+
+ReplicationSource::~ReplicationSource() {
+    stop();
+}
+
+void ReplicationSource::start() {
+    if (worker.joinable()) return;
+    stopping = false;
+    worker = thread(&ReplicationSource::run, this);
+}
+
+void ReplicationSource::stop() {
+    if (!worker.joinable()) return;
+    {
+        lock_guard<mutex> guard(replicasMutex);
+        stopping = true;
+    }
+    changesReady.notify_one();
+    worker.join();
+}
+
+void ReplicationSource::addReplica(DWORD pid, const vector<ChangeEvent>& snapshot, uint64_t lsn) {
+    {
+        lock_guard<mutex> guard(replicasMutex);
+        Replica& r = replicas[pid];
+        r.endpoint = ipc::Endpoint(replicaPipeName(pid));
+        r.pending.clear();
+        for (const ChangeEvent& ev : snapshot) {
+            r.pending[ev.id] = ev;
+        }
+        r.reset = true;
+        r.lsn = lsn;
+    }
+    changesReady.notify_one();
+}
+
+void ReplicationSource::publish(const ChangeEvent& ev, uint64_t lsn) {
+    {
+        lock_guard<mutex> guard(replicasMutex);
+        if (replicas.empty()) return;
+        for (auto& p : replicas) {
+            p.second.pending[ev.id] = ev;
+            p.second.lsn = lsn;
+        }
+    }
+    changesReady.notify_one();
+}
+
+size_t ReplicationSource::replicaCount() {
+    lock_guard<mutex> guard(replicasMutex);
+    return replicas.size();
+}
+
+bool ReplicationSource::hasWork() const {
+    for (auto& p : replicas) {
+        if (p.second.reset || !p.second.pending.empty()) return true;
+    }
+    return false;
+}
+
+void ReplicationSource::run() {
+    struct Delivery {
+        DWORD pid;
+        ipc::Endpoint endpoint;
+        ReplicationBatch batch;
+        vector<ChangeEvent> events;
+    };
+    vector<Delivery> deliveries;
+
+    unique_lock<mutex> guard(replicasMutex);
+    while (true) {
+        bool changed = changesReady.wait_for(guard, chrono::milliseconds(heartbeatMs),
+            [this] { return stopping || hasWork(); });
+        if (stopping) return;
+        if (!changed && replicas.empty()) continue;
+
+        // Без изменений за интервал каждому резервному уходит пустая пачка.
+        deliveries.clear();
+        for (auto& p : replicas) {
+            Replica& r = p.second;
+            if (changed && !r.reset && r.pending.empty()) continue;
+
+            Delivery d;
+            d.pid = p.first;
+            d.endpoint = r.endpoint;
+            d.batch.lsn = r.lsn;
+            d.batch.count = (uint32_t)r.pending.size();
+            d.batch.reset = r.reset;
+            d.events.reserve(r.pending.size());
+            for (auto& e : r.pending) d.events.push_back(e.second);
+            deliveries.push_back(d);
+
+            r.pending.clear();
+            r.reset = false;
+        }
+        guard.unlock();
+
+        for (auto& d : deliveries) {
+            ipc::Connection conn;
+            bool sent = ipc::connect(d.endpoint, conn)
+                && conn.sendAll(&d.batch, sizeof(d.batch))
+                && (d.events.empty() || conn.sendAll(d.events.data(), d.events.size() * sizeof(ChangeEvent)));
+            if (sent) continue;
+
+            cout << "Резервный сервер " << d.pid << " недоступен, репликация на него остановлена" << endl;
+            cout.flush();
+            lock_guard<mutex> drop(replicasMutex);
+            replicas.erase(d.pid);
+        }
+
+        guard.lock();
+    }
+}
+
+ReplicationSink::ReplicationSink() : batches(MAX_REPLICATION_EVENTS) {}
+
+ReplicationSink::~ReplicationSink() {
+    stop();
+}
+
+bool ReplicationSink::start(DWORD serverPid, Handler h) {
+    if (batches.isRunning()) return true;
+
+    handler = h;
+    return batches.start(replicaPipeName(serverPid),
+        [this](const ReplicationBatch& batch, const vector<ChangeEvent>& events) { receive(batch, events); });
+}
+
+void ReplicationSink::stop() {
+    batches.stop();
+}
+
+void ReplicationSink::receive(const ReplicationBatch& batch, const vector<ChangeEvent>& events) {
+    if (batch.count > 0 || batch.reset) handler(events, batch.reset, batch.lsn);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "batch_listener.h"
+#include "employee.h"
+#include "platform.h"
+
+// Рассылка зафиксированных изменений резервным серверам (на основном).
+// Как и уведомления подписчикам, изменения одной записи до доставки
+// сливаются: каждое событие несёт полное состояние записи, поэтому
+// резервному достаточно последнего. Если изменений нет дольше heartbeatMs,
+// резервным уходит пустая пачка. Резервный, до которого не удалось
+// достучаться, отключается; перестав получать пачки, он подключается заново.
+const unsigned REPLICATION_HEARTBEAT_MS = 500;
+
+class ReplicationSource {
+public:
+    explicit ReplicationSource(unsigned heartbeatMs = REPLICATION_HEARTBEAT_MS);
+    ~ReplicationSource();
+
+    void start();
+    void stop();
+
+    // snapshot — полное состояние на момент подключения, lsn — его номер.
+    void addReplica(DWORD pid, const std::vector<ChangeEvent>& snapshot, std::uint64_t lsn);
+    void publish(const ChangeEvent& ev, std::uint64_t lsn);
+    size_t replicaCount();
+
+private:
+    struct Replica {
+        ipc::Endpoint endpoint;
+        std::map<int, ChangeEvent> pending;
+        bool reset;
+        std::uint64_t lsn;
+    };
+
+    void run();
+    bool hasWork() const;
+
+    std::map<DWORD, Replica> replicas;
+    std::mutex replicasMutex;
+    std::condition_variable changesReady;
+    unsigned heartbeatMs;
+    bool stopping;
+    std::thread worker;
+};
+
+// Приём потока изменений на резервном сервере: пачки приходят в канал
+// replicaPipeName(pid) и передаются обработчику из потока приёмника.
+// Пустые пачки (пульс основного) обработчику не передаются, они только
+// обновляют lastHeard.
+class ReplicationSink {
+public:
+    typedef std::function<void(const std::vector<ChangeEvent>&, bool reset, std::uint64_t lsn)> Handler;
+
+    ReplicationSink();
+    ~ReplicationSink();
+
+    bool start(DWORD pid, Handler handler);
+    void stop();
+    bool isRunning() const { return batches.isRunning(); }
+    std::chrono::steady_clock::time_point lastHeard() const { return batches.lastHeard(); }
+
+private:
+    void receive(const ReplicationBatch& batch, const std::vector<ChangeEvent>& events);
+
+    Handler handler;
+    BatchListener<ReplicationBatch> batches;
+};
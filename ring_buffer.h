@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Очередь FIFO на кольцевом буфере. Буфер растёт вдвое, только когда
+// заполнен, поэтому при установившейся нагрузке push и pop не выделяют память.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t initialCapacity = 64)
+        : items(initialCapacity == 0 ? 1 : initialCapacity), head(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    size_t capacity() const { return items.size(); }
+
+    T& front() { return items[head]; }
+    const T& front() const { return items[head]; }
+
+    void push_back(const T& value) {
+        if (count == items.size()) grow();
+        items[(head + count) % items.size()] = value;
+        count++;
+    }
+
+    void pop_front() {
+        head = (head + 1) % items.size();
+        count--;
+    }
+
+private:
+    void grow() {
+        std::vector<T> larger(items.size() * 2);
+        for (size_t i = 0; i < count; i++) {
+            larger[i] = items[(head + i) % items.size()];
+        }
+        items.swap(larger);
+        head = 0;
+    }
+
+    std::vector<T> items;
+    size_t head;
+    size_t count;
+};
@@ -0,0 +1,154 @@
+﻿#include "shared_store.h"
+#include <cstring>
+
+using namespace std;
+
+static const size_t SHARED_STORE_SIZE =
+    sizeof(SharedStoreHeader) + SHARED_STORE_CAPACITY * sizeof(SharedSlot);
+
+static uint32_t slotIndex(int id) {
+    return ((uint32_t)id * 2654435761u) & (SHARED_STORE_CAPACITY - 1);
+}
+
+SharedStore::SharedStore() : header(nullptr), slots(nullptr), writer(false) {}
+
+// Область name создал сервер, который ещё работает.
+static bool heldByLiveServer(const string& name) {
+    SharedMemory existing;
+    if (!existing.open(name, SHARED_STORE_SIZE)) return false;
+
+    const SharedStoreHeader* h = (const SharedStoreHeader*)existing.data();
+    return h->magic.load(memory_order_acquire) == SHARED_STORE_MAGIC && processAlive(h->ownerPid);
+}
+
+bool SharedStore::create(const string& name, uint32_t epoch) {
+    close();
+    if (!memory.create(name, SHARED_STORE_SIZE)) {
+        // Область сервера, завершившегося аварийно, остаётся в системе.
+        if (heldByLiveServer(name) || !SharedMemory::remove(name)
+            || !memory.create(name, SHARED_STORE_SIZE)) {
+            return false;
+        }
+    }
+
+    // Новая область уже заполнена нулями, остаётся только заголовок.
+    header = (SharedStoreHeader*)memory.data();
+    slots = (SharedSlot*)(header + 1);
+    header->capacity = SHARED_STORE_CAPACITY;
+    header->ownerPid = currentProcessId();
+    header->epoch = epoch;
+    header->count.store(0, memory_order_relaxed);
+    header->magic.store(SHARED_STORE_MAGIC, memory_order_release);
+    writer = true;
+    return true;
+}
+
+bool SharedStore::open(const string& name) {
+    close();
+    if (!memory.open(name, SHARED_STORE_SIZE)) return false;
+
+    SharedStoreHeader* h = (SharedStoreHeader*)memory.data();
+    if (h->magic.load(memory_order_acquire) != SHARED_STORE_MAGIC
+        || h->capacity != SHARED_STORE_CAPACITY) {
+        memory.close();
+        return false;
+    }
+    header = h;
+    slots = (SharedSlot*)(header + 1);
+    return true;
+}
+
+void SharedStore::close() {
+    // Клиенты, у которых область ещё открыта, перестают ей верить.
+    if (writer) header->magic.store(0, memory_order_release);
+    memory.close();
+    header = nullptr;
+    slots = nullptr;
+    writer = false;
+}
+
+bool SharedStore::ownerAlive() const {
+    return header && processAlive(header->ownerPid);
+}
+
+// Слот с ключом id или nullptr. В free (если он задан) — куда поставить
+// отсутствующую запись: первый слот удалённой записи по пути или пустой слот.
+SharedSlot* SharedStore::find(int id, SharedSlot** free) const {
+    if (free) *free = nullptr;
+
+    uint32_t start = slotIndex(id);
+    for (uint32_t i = 0; i < SHARED_STORE_CAPACITY; i++) {
+        SharedSlot* slot = &slots[(start + i) & (SHARED_STORE_CAPACITY - 1)];
+        if (!slot->used.load(memory_order_acquire)) {
+            if (free && !*free) *free = slot;
+            return nullptr;
+        }
+        if (slot->key.load(memory_order_relaxed) == id) return slot;
+        if (free && !*free && slot->deleted) *free = slot;
+    }
+    return nullptr;
+}
+
+bool SharedStore::publish(const employee& e, uint32_t version) {
+    if (!header) return false;
+
+    SharedSlot* free;
+    SharedSlot* slot = find(e.num, &free);
+    if (!slot) slot = free;
+    if (!slot) return false;
+
+    uint32_t seq = slot->seq.load(memory_order_relaxed);
+    slot->seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->key.store(e.num, memory_order_relaxed);
+    memcpy(&slot->data, &e, sizeof(employee));
+    slot->version = version;
+    slot->deleted = 0;
+    slot->seq.store(seq + 2, memory_order_release);
+
+    if (!slot->used.load(memory_order_relaxed)) {
+        slot->used.store(1, memory_order_release);
+        header->count.fetch_add(1, memory_order_relaxed);
+    }
+    return true;
+}
+
+bool SharedStore::remove(int id, uint32_t version) {
+    if (!header) return false;
+
+    SharedSlot* slot = find(id, nullptr);
+    if (!slot) return false;
+
+    uint32_t seq = slot->seq.load(memory_order_relaxed);
+    slot->seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->version = version;
+    slot->deleted = 1;
+    slot->seq.store(seq + 2, memory_order_release);
+    return true;
+}
+
+bool SharedStore::lookup(int id, employee& out, uint32_t* version) const {
+    if (!header || header->magic.load(memory_order_acquire) != SHARED_STORE_MAGIC) return false;
+
+    const SharedSlot* slot = find(id, nullptr);
+    if (!slot) return false;
+
+    while (true) {
+        uint32_t before = slot->seq.load(memory_order_acquire);
+        if (before & 1) continue;
+
+        memcpy(&out, &slot->data, sizeof(employee));
+        uint32_t v = slot->version;
+        uint32_t deleted = slot->deleted;
+        int key = slot->key.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+
+        if (slot->seq.load(memory_order_relaxed) == before) {
+            // Слот успели отдать другой записи — искомая уже удалена.
+            if (deleted || key != id) return false;
+            if (version) *version = v;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "employee.h"
+#include "platform.h"
+
+// Область своя у каждого сервера: серверы с разными --name не затирают
+// друг другу записи.
+inline std::string sharedStoreName(const std::string& server) {
+    return "lab5_store_" + server;
+}
+
+// Открытая адресация: ёмкость — степень двойки. Удалённая запись сохраняет
+// свой слот с флагом deleted, чтобы не разрывать цепочки поиска; такой слот
+// занимает следующая добавленная запись, чья цепочка через него проходит.
+const std::uint32_t SHARED_STORE_CAPACITY = 4096;
+const std::uint32_t SHARED_STORE_MAGIC = 0x4C354D53;
+
+// Слот хранилища защищён seqlock'ом: сервер делает seq нечётным на время
+// записи, читатель повторяет копирование, если seq изменился.
+// version — версия записи на сервере (Response::version). key меняется
+// только под seqlock, при повторном использовании слота удалённой записи.
+struct SharedSlot {
+    std::atomic<std::uint32_t> seq;
+    std::atomic<std::uint32_t> used;
+    std::atomic<std::int32_t> key;
+    std::uint32_t version;
+    std::uint32_t deleted;
+    employee data;
+};
+
+// ownerPid — сервер, создавший область: область завершившегося сервера
+// можно занять заново. epoch — эпоха этого сервера (Response::epoch).
+// Закрывая область, сервер обнуляет magic, и клиенты перестают ей верить.
+struct SharedStoreHeader {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t capacity;
+    std::uint32_t ownerPid;
+    std::uint32_t epoch;
+    std::atomic<std::uint32_t> count;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+    "seqlock в разделяемой памяти требует lock-free атомиков");
+
+// Представление базы только для чтения, доступное клиентам на той же машине
+// без системных вызовов. Писатель один — сервер.
+class SharedStore {
+public:
+    SharedStore();
+
+    // false, если область name держит работающий сервер.
+    bool create(const std::string& name, std::uint32_t epoch = 0);
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+    std::uint32_t epoch() const { return header ? header->epoch : 0; }
+    // Сервер, создавший область, ещё работает.
+    bool ownerAlive() const;
+
+    // false — хранилище не открыто или в нём нет места.
+    bool publish(const employee& e, std::uint32_t version);
+    bool remove(int id, std::uint32_t version);
+    bool lookup(int id, employee& out, std::uint32_t* version = nullptr) const;
+
+private:
+    SharedSlot* find(int id, SharedSlot** free) const;
+
+    SharedMemory memory;
+    SharedStoreHeader* header;
+    SharedSlot* slots;
+    bool writer;
+};
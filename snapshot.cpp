@@ -0,0 +1,164 @@
+﻿#include "snapshot.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "platform.h"
+#include "record_format.h"
+
+using namespace std;
+
+static const unsigned CHECKPOINT_RETRY_MS = 1000;
+static const size_t SNAPSHOT_BLOCK_RECORDS = 2048;
+
+bool writeSnapshot(const string& filename, const map<size_t, employee>& dirty, size_t slotCount) {
+    string tmp = filename + ".tmp";
+    {
+        // Прежний файл должен быть в формате версии 2: слоты переносятся
+        // из него как есть, а сырой файл сервер переводит при загрузке.
+        size_t baseCount = 0;
+        ifstream in(filename, ios::binary);
+        if (in.is_open()) {
+            unsigned char raw[RECORD_HEADER_SIZE];
+            RecordFileHeader base;
+            if (!in.read((char*)raw, sizeof(raw)) || !decodeHeader(raw, base)) return false;
+            baseCount = base.count;
+        }
+
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+
+        RecordFileHeader header{};
+        header.magic = RECORD_FILE_MAGIC;
+        header.version = RECORD_FILE_VERSION;
+        header.recordSize = (uint16_t)RECORD_SIZE;
+        header.count = (uint32_t)slotCount;
+
+        unsigned char raw[RECORD_HEADER_SIZE];
+        encodeHeader(header, raw);
+        out.write((const char*)raw, sizeof(raw));
+
+        // Слоты идут блоками: неизменённые читаются из прежнего файла, изменённые
+        // накладываются поверх, и по готовому блоку сразу считается контрольная сумма.
+        unsigned char missing[RECORD_SIZE];
+        employee tombstone{};
+        tombstone.num = TOMBSTONE_ID;
+        encodeRecord(tombstone, missing);
+
+        vector<unsigned char> block(SNAPSHOT_BLOCK_RECORDS * RECORD_SIZE);
+        auto next = dirty.begin();
+        for (size_t first = 0; first < slotCount; first += SNAPSHOT_BLOCK_RECORDS) {
+            size_t n = min(SNAPSHOT_BLOCK_RECORDS, slotCount - first);
+
+            size_t fromBase = 0;
+            if (first < baseCount) {
+                in.read((char*)block.data(), (streamsize)(min(n, baseCount - first) * RECORD_SIZE));
+                fromBase = (size_t)in.gcount() / RECORD_SIZE;
+            }
+            for (size_t i = fromBase; i < n; i++) {
+                memcpy(block.data() + i * RECORD_SIZE, missing, RECORD_SIZE);
+            }
+
+            for (; next != dirty.end() && next->first < first + n; ++next) {
+                encodeRecord(next->second, block.data() + (next->first - first) * RECORD_SIZE);
+            }
+
+            header.checksum = updateChecksum(header.checksum, block.data(), n * RECORD_SIZE);
+            out.write((const char*)block.data(), (streamsize)(n * RECORD_SIZE));
+        }
+
+        encodeHeader(header, raw);
+        out.seekp(0);
+        out.write((const char*)raw, sizeof(raw));
+        out.close();
+        if (!out) return false;
+    }
+
+    return syncFile(tmp) && replaceFile(tmp, filename);
+}
+
+Checkpointer::Checkpointer() : slotCount(0), savedSlotCount(0), stopping(false) {}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::start(const string& name, size_t slots) {
+    filename = name;
+    slotCount = slots;
+    savedSlotCount = slots;
+    stopping = false;
+    worker = thread(&Checkpointer::run, this);
+}
+
+void Checkpointer::submit(const map<size_t, employee>& records, size_t slots) {
+    {
+        lock_guard<mutex> guard(queueMutex);
+        slotCount = slots;
+        // Слоты, отрезанные уплотнением, записывать уже не нужно.
+        queued.erase(queued.lower_bound(slotCount), queued.end());
+        for (auto& p : records) {
+            queued[p.first] = p.second;
+        }
+    }
+    queueReady.notify_one();
+}
+
+void Checkpointer::stop() {
+    if (!worker.joinable()) return;
+    {
+        lock_guard<mutex> guard(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_one();
+    worker.join();
+}
+
+bool Checkpointer::hasWork() const {
+    return !queued.empty() || slotCount != savedSlotCount;
+}
+
+void Checkpointer::run() {
+    unique_lock<mutex> guard(queueMutex);
+    while (true) {
+        queueReady.wait_for(guard, chrono::milliseconds(CHECKPOINT_RETRY_MS),
+            [this] { return stopping || hasWork(); });
+        if (!hasWork()) {
+            if (stopping) return;
+            continue;
+        }
+
+        map<size_t, employee> batch;
+        batch.swap(queued);
+        size_t slots = slotCount;
+        guard.unlock();
+
+        bool ok = writeSnapshot(filename, batch, slots);
+        if (ok) {
+            cout << "Контрольная точка: сохранено записей " << batch.size() << endl;
+        }
+        else {
+            cout << "Ошибка записи контрольной точки: " << lastError() << endl;
+        }
+        cout.flush();
+
+        guard.lock();
+        if (ok) {
+            savedSlotCount = slots;
+            continue;
+        }
+
+        // Более свежие версии тех же слотов, пришедшие за время записи, важнее.
+        for (auto& p : batch) {
+            queued.insert(p);
+        }
+        if (stopping) {
+            cout << "Не удалось сохранить записей: " << queued.size() << endl;
+            cout.flush();
+            return;
+        }
+        queueReady.wait_for(guard, chrono::milliseconds(CHECKPOINT_RETRY_MS),
+            [this] { return stopping; });
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "employee.h"
+
+// Записывает изменённые записи (номер слота в файле -> запись) в новый
+// файл-снимок формата версии 2 (record_format.h) из slotCount слотов и
+// атомарно подменяет им filename. Неизменённые записи переносятся из прежнего
+// файла блоками, слоты за пределами slotCount отбрасываются.
+bool writeSnapshot(const std::string& filename, const std::map<size_t, employee>& dirty,
+    size_t slotCount);
+
+// Фоновые контрольные точки: сервер передаёт копии изменённых записей,
+// поток записывает их, не останавливая обработку запросов. Если запись
+// не удалась, записи остаются в очереди до следующей попытки.
+class Checkpointer {
+public:
+    Checkpointer();
+    ~Checkpointer();
+
+    void start(const std::string& filename, size_t slotCount);
+    void submit(const std::map<size_t, employee>& records, size_t slotCount);
+    // Дописывает всё, что осталось в очереди, и останавливает поток.
+    void stop();
+
+private:
+    void run();
+
+    std::string filename;
+    bool hasWork() const;
+
+    std::map<size_t, employee> queued;
+    size_t slotCount;
+    size_t savedSlotCount;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    bool stopping;
+    std::thread worker;
+};